@@ -0,0 +1,798 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "Engine.h"
+
+// xorshift64* — a few cycles per draw; for agents and benchmark drivers, not
+// for anything that has to be reproducible across versions.
+class FastRng
+{
+public:
+    explicit FastRng(uint64_t seed) : s_(seed != 0 ? seed : 0x9E3779B97F4A7C15ull) {}
+    uint64_t next()
+    {
+        s_ ^= s_ >> 12;
+        s_ ^= s_ << 25;
+        s_ ^= s_ >> 27;
+        return s_ * 0x2545F4914F6CDD1Dull;
+    }
+
+private:
+    uint64_t s_;
+};
+
+// Fixed set of worker threads running parallel-for jobs.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threads)
+    {
+        for (unsigned i = 1; i < std::max(1u, threads); i++)
+        {
+            workers_.emplace_back([this, i] { loop(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread &t : workers_)
+        {
+            t.join();
+        }
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+    // Calls fn(index, worker) for every index in [0, count) and returns when
+    // all are done. The calling thread takes part as worker 0.
+    void run(size_t count, const std::function<void(size_t, unsigned)> &fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            job_ = &fn;
+            count_ = count;
+            next_ = 0;
+            pending_ = static_cast<unsigned>(workers_.size());
+            generation_++;
+        }
+        wake_.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> lock(m_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex m_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t, unsigned)> *job_{nullptr};
+    size_t count_{0};
+    std::atomic<size_t> next_{0};
+    unsigned pending_{0};
+    uint64_t generation_{0};
+    bool stop_{false};
+
+    void loop(unsigned id)
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_)
+                {
+                    return;
+                }
+                seen = generation_;
+            }
+            work(id);
+            std::lock_guard<std::mutex> lock(m_);
+            if (--pending_ == 0)
+            {
+                done_.notify_one();
+            }
+        }
+    }
+
+    void work(unsigned id)
+    {
+        for (size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1))
+        {
+            (*job_)(i, id);
+        }
+    }
+};
+
+// Autopilot interface: picks the direction for the next tick.
+class Agent
+{
+public:
+    virtual ~Agent() = default;
+    virtual Dir decide(const Engine &engine) = 0;
+};
+
+// Keeps going straight and turns at random, onto a safe cell when there is
+// one. Its choices hash (seed, game, tick), so a game plays the same however
+// it is scheduled. Cheap enough to simulate millions of games.
+class RandomAgent : public Agent
+{
+public:
+    Dir decide(const Engine &e) override
+    {
+        FastRng rng(e.seed() ^ (static_cast<uint64_t>(e.gameId()) << 32) ^ (e.tick() * 0x9E3779B97F4A7C15ull));
+        uint64_t r = rng.next();
+        if ((r & 7) != 0 && e.safe(e.dir()))
+        {
+            return e.dir();
+        }
+        int start = static_cast<int>((r >> 3) & 3);
+        for (int k = 0; k < 4; k++)
+        {
+            Dir d = static_cast<Dir>((start + k) & 3);
+            if (!Engine::isOpposite(e.dir(), d) && e.safe(d))
+            {
+                return d;
+            }
+        }
+        return e.dir();
+    }
+};
+
+struct MctsConfig
+{
+    int playouts{2000};
+    int depth{20};
+    double explore{0.7};
+    unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+};
+
+// UCT search over simulated futures. Each worker grows its own tree from a
+// private copy of the game (root parallelism) and the root visit counts are
+// summed. Simulations run on a reseeded clone, so they plan against random
+// food rather than the real, seed-determined spawns.
+class MctsAgent : public Agent
+{
+public:
+    explicit MctsAgent(const MctsConfig &config = MctsConfig{})
+        : config_(config), pool_(config.threads), workers_(pool_.size())
+    {
+    }
+
+    Dir decide(const Engine &engine) override
+    {
+        auto start = std::chrono::steady_clock::now();
+        unsigned n = pool_.size();
+        int perWorker = std::max(1, config_.playouts / static_cast<int>(n));
+        decisions_++;
+        pool_.run(n, [&](size_t w, unsigned) { search(workers_[w], engine, perWorker, w); });
+
+        std::array<uint64_t, 4> visits{};
+        for (Worker &w : workers_)
+        {
+            for (int d = 0; d < 4; d++)
+            {
+                visits[d] += w.rootVisits[d];
+            }
+        }
+        Dir best = engine.dir();
+        uint64_t bestVisits = 0;
+        for (int d = 0; d < 4; d++)
+        {
+            if (visits[d] > bestVisits)
+            {
+                bestVisits = visits[d];
+                best = static_cast<Dir>(d);
+            }
+        }
+        playouts_ += static_cast<uint64_t>(perWorker) * n;
+        seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return best;
+    }
+
+    uint64_t playouts() const { return playouts_; }
+    double searchSeconds() const { return seconds_; }
+
+private:
+    static constexpr int kNone = -1;
+
+    struct Node
+    {
+        int parent{kNone};
+        std::array<int, 4> child{kNone, kNone, kNone, kNone};
+        uint32_t visits{0};
+        double value{0};
+        uint8_t untried{0};
+    };
+
+    struct Worker
+    {
+        std::unique_ptr<Engine> sim;
+        std::vector<Node> tree;
+        FastRng rng{1};
+        std::array<uint64_t, 4> rootVisits{};
+    };
+
+    MctsConfig config_;
+    ThreadPool pool_;
+    std::vector<Worker> workers_;
+    uint64_t decisions_{0};
+    uint64_t playouts_{0};
+    double seconds_{0};
+
+    // Moves worth trying from the sim's current state: the non-reversing
+    // ones that survive the next tick, or all non-reversing ones if none do.
+    static uint8_t movesFrom(const Engine &sim)
+    {
+        uint8_t legal = 0;
+        uint8_t safe = 0;
+        for (int d = 0; d < 4; d++)
+        {
+            if (!Engine::isOpposite(sim.dir(), static_cast<Dir>(d)))
+            {
+                legal |= static_cast<uint8_t>(1u << d);
+                if (sim.safe(static_cast<Dir>(d)))
+                {
+                    safe |= static_cast<uint8_t>(1u << d);
+                }
+            }
+        }
+        return safe != 0 ? safe : legal;
+    }
+
+    // Manhattan distance from the head to the closest food; a shaping term so
+    // short rollouts still prefer heading towards food.
+    static int nearestFood(const Engine &sim)
+    {
+        Vec2 head = sim.head();
+        int best = sim.width() + sim.height();
+        for (const Pickup &p : sim.items())
+        {
+            if (p.item == Item::Food)
+            {
+                best = std::min(best, std::abs(p.pos.x - head.x) + std::abs(p.pos.y - head.y));
+            }
+        }
+        return best;
+    }
+
+    static int pickBit(uint8_t mask, uint64_t r)
+    {
+        int count = (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+        int k = static_cast<int>(r % static_cast<uint64_t>(count));
+        for (int d = 0; d < 4; d++)
+        {
+            if ((mask >> d) & 1u)
+            {
+                if (k-- == 0)
+                {
+                    return d;
+                }
+            }
+        }
+        return 0;
+    }
+
+    void search(Worker &w, const Engine &root, int playouts, size_t id)
+    {
+        if (!w.sim)
+        {
+            w.sim = std::make_unique<Engine>(root);
+        }
+        w.rng = FastRng(root.seed() ^ (root.tick() * 0x9E3779B97F4A7C15ull) ^ (decisions_ << 20) ^ (id + 1));
+        w.tree.clear();
+        w.tree.emplace_back();
+        w.tree[0].untried = movesFrom(root);
+        Engine &sim = *w.sim;
+
+        for (int p = 0; p < playouts; p++)
+        {
+            sim.copyFrom(root);
+            sim.reseed(w.rng.next());
+            int startScore = sim.score();
+            int n = 0;
+
+            while (!sim.gameOver())
+            {
+                Node &node = w.tree[n];
+                if (node.untried != 0)
+                {
+                    int d = pickBit(node.untried, w.rng.next());
+                    node.untried = static_cast<uint8_t>(node.untried & ~(1u << d));
+                    sim.turn(static_cast<Dir>(d));
+                    sim.step();
+                    int child = static_cast<int>(w.tree.size());
+                    w.tree[n].child[d] = child;
+                    w.tree.emplace_back();
+                    w.tree[child].parent = n;
+                    w.tree[child].untried = sim.gameOver() ? 0 : movesFrom(sim);
+                    n = child;
+                    break;
+                }
+                int best = kNone;
+                double bestScore = -1e300;
+                double logN = std::log(static_cast<double>(node.visits) + 1.0);
+                for (int d = 0; d < 4; d++)
+                {
+                    int c = node.child[d];
+                    if (c == kNone)
+                    {
+                        continue;
+                    }
+                    const Node &cn = w.tree[c];
+                    double uct = cn.value / cn.visits + config_.explore * std::sqrt(logN / cn.visits);
+                    if (uct > bestScore)
+                    {
+                        bestScore = uct;
+                        best = d;
+                    }
+                }
+                if (best == kNone)
+                {
+                    break;
+                }
+                sim.turn(static_cast<Dir>(best));
+                sim.step();
+                n = node.child[best];
+            }
+
+            for (int i = 0; i < config_.depth && !sim.gameOver(); i++)
+            {
+                sim.turn(static_cast<Dir>(pickBit(movesFrom(sim), w.rng.next())));
+                sim.step();
+            }
+
+            double reward = (sim.score() - startScore) / 10.0;
+            if (!sim.gameOver())
+            {
+                reward += 1.0 + 1.0 / (1.0 + nearestFood(sim));
+            }
+            for (int i = n; i != kNone; i = w.tree[i].parent)
+            {
+                w.tree[i].visits++;
+                w.tree[i].value += reward;
+            }
+        }
+
+        for (int d = 0; d < 4; d++)
+        {
+            int c = w.tree[0].child[d];
+            w.rootVisits[d] = c == kNone ? 0 : w.tree[c].visits;
+        }
+    }
+};
+
+// Weights of the heuristic agent's move score. The fields are what the
+// evolutionary trainer tunes and what --genome files store, in this order.
+struct Genome
+{
+    static constexpr int kSize = 4;
+    // reachable area share, closeness to food, tail reachable, food eaten
+    std::array<double, kSize> w{4.0, 1.0, 2.0, 1.0};
+
+    bool save(const std::string &path) const
+    {
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            out << std::setprecision(17);
+            for (double v : w)
+            {
+                out << v << "\n";
+            }
+            if (!out)
+            {
+                return false;
+            }
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path);
+        Genome g;
+        for (double &v : g.w)
+        {
+            if (!(in >> v))
+            {
+                return false;
+            }
+        }
+        *this = g;
+        return true;
+    }
+};
+
+// One-ply lookahead: simulates each non-reversing move on a scratch copy and
+// scores the result from a flood fill of the space the head can still reach.
+class HeuristicAgent : public Agent
+{
+public:
+    explicit HeuristicAgent(const Genome &genome = Genome{}) : genome_(genome) {}
+
+    void setGenome(const Genome &genome) { genome_ = genome; }
+
+    Dir decide(const Engine &engine) override
+    {
+        if (!sim_)
+        {
+            sim_ = std::make_unique<Engine>(engine);
+        }
+        Dir best = engine.dir();
+        double bestScore = -1e300;
+        for (int d = 0; d < 4; d++)
+        {
+            Dir dir = static_cast<Dir>(d);
+            if (Engine::isOpposite(engine.dir(), dir) || !engine.safe(dir))
+            {
+                continue;
+            }
+            sim_->copyFrom(engine);
+            sim_->turn(dir);
+            bool ate = sim_->step();
+            if (sim_->gameOver())
+            {
+                continue;
+            }
+            double score = evaluate(*sim_, ate);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = dir;
+            }
+        }
+        return best;
+    }
+
+private:
+    Genome genome_;
+    std::unique_ptr<Engine> sim_;
+    BitFlood flood_;
+
+    double evaluate(const Engine &sim, bool ate)
+    {
+        Vec2 head = sim.head();
+        Vec2 tail = sim.pos(sim.snake().back());
+        // The tail counts as reachable when a reached cell borders it, since
+        // it moves away as the snake advances.
+        int area = flood_.area(sim, head);
+        bool tailReachable = false;
+        for (int d = 0; d < 4; d++)
+        {
+            tailReachable = tailReachable || flood_.reached().test(sim.neighbor(tail, static_cast<Dir>(d)));
+        }
+
+        int nearest = sim.width() + sim.height();
+        for (const Pickup &p : sim.items())
+        {
+            if (p.item == Item::Food)
+            {
+                nearest = std::min(nearest, std::abs(p.pos.x - head.x) + std::abs(p.pos.y - head.y));
+            }
+        }
+
+        double space = static_cast<double>(area) / static_cast<double>(sim.snake().size());
+        return genome_.w[0] * std::min(space, 1.0) + genome_.w[1] / (1.0 + nearest) +
+               genome_.w[2] * (tailReachable ? 1.0 : 0.0) + genome_.w[3] * (ate ? 1.0 : 0.0);
+    }
+};
+
+// Small MLP policy: kInputs board features -> ReLU hidden layer -> one logit
+// per direction. Weights are stored transposed and padded to multiples of 8
+// floats, so both layers are runs of contiguous multiply-adds that map onto
+// AVX2 or NEON when the build targets them.
+//
+// File format (little-endian): u32 magic "SMLP", u32 inputs, u32 hidden,
+// u32 outputs, then f32 W1[hidden][inputs], b1[hidden], W2[outputs][hidden],
+// b2[outputs] (the usual out-by-in layout of a linear layer).
+class MlpPolicy
+{
+public:
+    static constexpr int kInputs = 64;
+    static constexpr int kOutputs = 4;
+    static constexpr int kMaxHidden = 1024;
+    static constexpr uint32_t kMagic = 0x504C4D53u;
+
+    bool load(const std::string &path, std::string &error)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            error = "cannot open weights file: " + path;
+            return false;
+        }
+        uint32_t header[4] = {};
+        if (file.size() < sizeof(header))
+        {
+            error = "weights file too short";
+            return false;
+        }
+        std::memcpy(header, file.data(), sizeof(header));
+        int hidden = static_cast<int>(header[2]);
+        if (header[0] != kMagic || header[1] != kInputs || header[3] != kOutputs || hidden <= 0 ||
+            hidden > kMaxHidden)
+        {
+            error = "weights file has wrong magic or shape";
+            return false;
+        }
+        size_t floats = static_cast<size_t>(hidden) * kInputs + hidden + kOutputs * static_cast<size_t>(hidden) +
+                        kOutputs;
+        if (file.size() != sizeof(header) + floats * sizeof(float))
+        {
+            error = "weights file size does not match its shape";
+            return false;
+        }
+        std::vector<float> raw(floats);
+        std::memcpy(raw.data(), file.data() + sizeof(header), floats * sizeof(float));
+        setWeights(hidden, raw);
+        return true;
+    }
+
+    bool save(const std::string &path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        uint32_t header[4] = {kMagic, kInputs, static_cast<uint32_t>(hidden_), kOutputs};
+        out.write(reinterpret_cast<const char *>(header), sizeof(header));
+        for (int h = 0; h < hidden_; h++)
+        {
+            for (int i = 0; i < kInputs; i++)
+            {
+                out.write(reinterpret_cast<const char *>(&w1_[static_cast<size_t>(i) * stride_ + h]), sizeof(float));
+            }
+        }
+        out.write(reinterpret_cast<const char *>(b1_.data()), static_cast<std::streamsize>(hidden_ * sizeof(float)));
+        for (int o = 0; o < kOutputs; o++)
+        {
+            out.write(reinterpret_cast<const char *>(&w2_[static_cast<size_t>(o) * stride_]),
+                      static_cast<std::streamsize>(hidden_ * sizeof(float)));
+        }
+        out.write(reinterpret_cast<const char *>(b2_.data()), sizeof(float) * kOutputs);
+        return static_cast<bool>(out);
+    }
+
+    // He-style uniform init; a starting point for external training.
+    void randomize(int hidden, uint64_t seed)
+    {
+        FastRng rng(seed);
+        size_t floats = static_cast<size_t>(hidden) * kInputs + hidden + kOutputs * static_cast<size_t>(hidden) +
+                        kOutputs;
+        std::vector<float> raw(floats);
+        for (size_t i = 0; i < floats; i++)
+        {
+            float u = static_cast<float>(rng.next() >> 40) * 0x1.0p-24f * 2.0f - 1.0f;
+            raw[i] = u * (i < static_cast<size_t>(hidden) * kInputs ? 0.3f : 0.2f);
+        }
+        setWeights(hidden, raw);
+    }
+
+    // Board features around the head: a 7x7 blocked/open window, the
+    // direction of the nearest food, the current heading and the length.
+    static void features(const Engine &e, float *x)
+    {
+        std::fill(x, x + kInputs, 0.0f);
+        Vec2 head = e.head();
+        int k = 0;
+        for (int dy = -3; dy <= 3; dy++)
+        {
+            for (int dx = -3; dx <= 3; dx++)
+            {
+                Vec2 p{head.x + dx, head.y + dy};
+                bool inside = p.x >= 0 && p.y >= 0 && p.x < e.width() && p.y < e.height();
+                x[k++] = (!inside || (!(dx == 0 && dy == 0) && !e.open(p))) ? 1.0f : 0.0f;
+            }
+        }
+        Vec2 food = head;
+        int nearest = e.width() + e.height();
+        for (const Pickup &p : e.items())
+        {
+            int dist = std::abs(p.pos.x - head.x) + std::abs(p.pos.y - head.y);
+            if (p.item == Item::Food && dist < nearest)
+            {
+                nearest = dist;
+                food = p.pos;
+            }
+        }
+        x[49] = food.x < head.x ? 1.0f : 0.0f;
+        x[50] = food.x > head.x ? 1.0f : 0.0f;
+        x[51] = food.y < head.y ? 1.0f : 0.0f;
+        x[52] = food.y > head.y ? 1.0f : 0.0f;
+        x[53 + static_cast<int>(e.dir())] = 1.0f;
+        x[57] = static_cast<float>(e.snake().size()) / static_cast<float>(e.width() * e.height());
+    }
+
+    // logits[kOutputs] for one feature vector; hidden needs stride() floats.
+    void forward(const float *x, float *logits, float *hidden) const
+    {
+        std::memcpy(hidden, b1_.data(), stride_ * sizeof(float));
+        for (int i = 0; i < kInputs; i++)
+        {
+            axpy(x[i], &w1_[static_cast<size_t>(i) * stride_], hidden, stride_);
+        }
+        for (int o = 0; o < kOutputs; o++)
+        {
+            logits[o] = b2_[o] + dotRelu(&w2_[static_cast<size_t>(o) * stride_], hidden, stride_);
+        }
+    }
+
+    int stride() const { return stride_; }
+
+private:
+    int hidden_{0};
+    int stride_{0};
+    std::vector<float> w1_; // [kInputs][stride_]
+    std::vector<float> b1_; // [stride_]
+    std::vector<float> w2_; // [kOutputs][stride_]
+    std::array<float, kOutputs> b2_{};
+
+    void setWeights(int hidden, const std::vector<float> &raw)
+    {
+        hidden_ = hidden;
+        stride_ = (hidden + 7) & ~7;
+        w1_.assign(static_cast<size_t>(kInputs) * stride_, 0.0f);
+        b1_.assign(static_cast<size_t>(stride_), 0.0f);
+        w2_.assign(static_cast<size_t>(kOutputs) * stride_, 0.0f);
+        size_t at = 0;
+        for (int h = 0; h < hidden; h++)
+        {
+            for (int i = 0; i < kInputs; i++)
+            {
+                w1_[static_cast<size_t>(i) * stride_ + h] = raw[at++];
+            }
+        }
+        for (int h = 0; h < hidden; h++)
+        {
+            b1_[h] = raw[at++];
+        }
+        for (int o = 0; o < kOutputs; o++)
+        {
+            for (int h = 0; h < hidden; h++)
+            {
+                w2_[static_cast<size_t>(o) * stride_ + h] = raw[at++];
+            }
+        }
+        for (int o = 0; o < kOutputs; o++)
+        {
+            b2_[o] = raw[at++];
+        }
+    }
+
+    // y += a * x over n floats (n is a multiple of 8).
+    static void axpy(float a, const float *x, float *y, int n)
+    {
+        if (a == 0.0f)
+        {
+            return;
+        }
+#if defined(__AVX2__) && defined(__FMA__)
+        __m256 va = _mm256_set1_ps(a);
+        for (int i = 0; i < n; i += 8)
+        {
+            _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+        }
+#elif defined(__ARM_NEON)
+        float32x4_t va = vdupq_n_f32(a);
+        for (int i = 0; i < n; i += 4)
+        {
+            vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), va, vld1q_f32(x + i)));
+        }
+#else
+        for (int i = 0; i < n; i++)
+        {
+            y[i] += a * x[i];
+        }
+#endif
+    }
+
+    // sum(w[i] * max(h[i], 0)) over n floats (n is a multiple of 8).
+    static float dotRelu(const float *w, const float *h, int n)
+    {
+#if defined(__AVX2__) && defined(__FMA__)
+        __m256 acc = _mm256_setzero_ps();
+        __m256 zero = _mm256_setzero_ps();
+        for (int i = 0; i < n; i += 8)
+        {
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(w + i), _mm256_max_ps(_mm256_loadu_ps(h + i), zero), acc);
+        }
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+#elif defined(__ARM_NEON)
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        float32x4_t zero = vdupq_n_f32(0.0f);
+        for (int i = 0; i < n; i += 4)
+        {
+            acc = vmlaq_f32(acc, vld1q_f32(w + i), vmaxq_f32(vld1q_f32(h + i), zero));
+        }
+        float lanes[4];
+        vst1q_f32(lanes, acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+        float acc = 0.0f;
+        for (int i = 0; i < n; i++)
+        {
+            acc += w[i] * std::max(h[i], 0.0f);
+        }
+        return acc;
+#endif
+    }
+};
+
+class MlpAgent : public Agent
+{
+public:
+    explicit MlpAgent(MlpPolicy policy) : policy_(std::move(policy)), hidden_(policy_.stride()) {}
+
+    Dir decide(const Engine &engine) override
+    {
+        Dir out{};
+        decideBatch(&engine, 1, &out);
+        return out;
+    }
+
+    // Picks moves for n games at once: features for the whole batch first,
+    // then the forward passes back to back while the weights stay in cache.
+    void decideBatch(const Engine *games, size_t n, Dir *out)
+    {
+        x_.resize(n * MlpPolicy::kInputs);
+        for (size_t g = 0; g < n; g++)
+        {
+            MlpPolicy::features(games[g], &x_[g * MlpPolicy::kInputs]);
+        }
+        for (size_t g = 0; g < n; g++)
+        {
+            float logits[MlpPolicy::kOutputs];
+            policy_.forward(&x_[g * MlpPolicy::kInputs], logits, hidden_.data());
+            Dir current = games[g].dir();
+            Dir best = current;
+            float bestLogit = -1e30f;
+            for (int d = 0; d < MlpPolicy::kOutputs; d++)
+            {
+                if (!Engine::isOpposite(current, static_cast<Dir>(d)) && logits[d] > bestLogit)
+                {
+                    bestLogit = logits[d];
+                    best = static_cast<Dir>(d);
+                }
+            }
+            out[g] = best;
+        }
+    }
+
+private:
+    MlpPolicy policy_;
+    std::vector<float> hidden_;
+    std::vector<float> x_;
+};
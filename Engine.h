@@ -0,0 +1,1783 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct Vec2
+{
+    int x{};
+    int y{};
+    bool operator==(const Vec2 &other) const { return x == other.x && y == other.y; }
+};
+
+enum class Dir
+{
+    Up,
+    Down,
+    Left,
+    Right
+};
+
+// Per-direction tables, indexed by Dir: moving and reversing are one load
+// instead of a chain of compares.
+constexpr std::array<Vec2, 4> kDirDelta{{{0, -1}, {0, 1}, {-1, 0}, {1, 0}}};
+constexpr std::array<Dir, 4> kOpposite{Dir::Down, Dir::Up, Dir::Right, Dir::Left};
+
+inline Vec2 delta(Dir d)
+{
+    return kDirDelta[static_cast<int>(d)];
+}
+
+inline Dir opposite(Dir d)
+{
+    return kOpposite[static_cast<int>(d)];
+}
+
+// Key byte -> Dir for WASD in either case, -1 for every other key.
+constexpr std::array<int8_t, 256> makeKeyDirs()
+{
+    std::array<int8_t, 256> t{};
+    for (int i = 0; i < 256; i++)
+    {
+        t[i] = -1;
+    }
+    const char keys[] = "wsad";
+    for (int d = 0; d < 4; d++)
+    {
+        t[static_cast<uint8_t>(keys[d])] = static_cast<int8_t>(d);
+        t[static_cast<uint8_t>(keys[d] - 'a' + 'A')] = static_cast<int8_t>(d);
+    }
+    return t;
+}
+constexpr std::array<int8_t, 256> kKeyDirs = makeKeyDirs();
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// The output is a pure function of (key, counter), so any draw of any game can
+// be recomputed independently of how many other draws happened before it.
+struct Philox
+{
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static Counter generate(Counter ctr, Key key)
+    {
+        for (int round = 0; round < 10; round++)
+        {
+            uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0];
+            uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2];
+            ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(p1),
+                   static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(p0)};
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+        return ctr;
+    }
+
+    // Four independent blocks at once, in place. With AVX2 each 32-bit word
+    // sits in a 64-bit lane so one _mm256_mul_epu32 does all four multiplies.
+    static void generate4(Counter *ctr, const Key *key)
+    {
+#if defined(__AVX2__)
+        __m256i c0 = _mm256_set_epi64x(ctr[3][0], ctr[2][0], ctr[1][0], ctr[0][0]);
+        __m256i c1 = _mm256_set_epi64x(ctr[3][1], ctr[2][1], ctr[1][1], ctr[0][1]);
+        __m256i c2 = _mm256_set_epi64x(ctr[3][2], ctr[2][2], ctr[1][2], ctr[0][2]);
+        __m256i c3 = _mm256_set_epi64x(ctr[3][3], ctr[2][3], ctr[1][3], ctr[0][3]);
+        __m256i k0 = _mm256_set_epi64x(key[3][0], key[2][0], key[1][0], key[0][0]);
+        __m256i k1 = _mm256_set_epi64x(key[3][1], key[2][1], key[1][1], key[0][1]);
+        const __m256i m0 = _mm256_set1_epi64x(0xD2511F53u);
+        const __m256i m1 = _mm256_set1_epi64x(0xCD9E8D57u);
+        const __m256i w0 = _mm256_set1_epi64x(0x9E3779B9u);
+        const __m256i w1 = _mm256_set1_epi64x(0xBB67AE85u);
+        const __m256i low = _mm256_set1_epi64x(0xFFFFFFFFu);
+        // Only the low halves of the lanes are meaningful; carries that reach
+        // the high halves never flow back down.
+        for (int round = 0; round < 10; round++)
+        {
+            __m256i p0 = _mm256_mul_epu32(c0, m0);
+            __m256i p1 = _mm256_mul_epu32(c2, m1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), k0);
+            c1 = _mm256_and_si256(p1, low);
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), k1);
+            c3 = _mm256_and_si256(p0, low);
+            k0 = _mm256_add_epi32(k0, w0);
+            k1 = _mm256_add_epi32(k1, w1);
+        }
+        alignas(32) uint64_t out[4][4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out[0]), c0);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out[1]), c1);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out[2]), c2);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out[3]), c3);
+        for (int g = 0; g < 4; g++)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                ctr[g][k] = static_cast<uint32_t>(out[k][g]);
+            }
+        }
+#else
+        for (int g = 0; g < 4; g++)
+        {
+            ctr[g] = generate(ctr[g], key[g]);
+        }
+#endif
+    }
+};
+
+// Counter-based random stream keyed by (seed, game id). Draws are addressed by
+// (tick, draw) instead of advancing hidden state, so a game's food sequence
+// depends only on the seed and the inputs, never on scheduling.
+class Random
+{
+public:
+    Random() = default;
+    Random(uint64_t seed, uint32_t gameId)
+        : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}, gameId_(gameId)
+    {
+    }
+
+    Philox::Counter block(uint64_t tick, uint32_t draw) const
+    {
+        return Philox::generate(counter(tick, draw), key_);
+    }
+
+    // Philox input of block(tick, draw), for callers that batch generation.
+    Philox::Counter counter(uint64_t tick, uint32_t draw) const
+    {
+        return {static_cast<uint32_t>(tick), static_cast<uint32_t>(tick >> 32), gameId_, draw};
+    }
+
+    const Philox::Key &key() const { return key_; }
+
+    // Maps a 32-bit draw onto [lo, hi] with a multiply-shift.
+    static int range(uint32_t bits, int lo, int hi)
+    {
+        uint64_t span = static_cast<uint64_t>(hi - lo + 1);
+        return lo + static_cast<int>((bits * span) >> 32);
+    }
+
+private:
+    Philox::Key key_{};
+    uint32_t gameId_{0};
+};
+
+inline uint64_t randomSeed()
+{
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+// Read-only view of a whole file. Level files are mapped rather than read so
+// large maps are parsed straight out of the page cache.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { close(); }
+
+#ifdef _WIN32
+    bool open(const std::string &path)
+    {
+        close();
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file_, &size))
+        {
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(size.QuadPart);
+        if (size_ == 0)
+        {
+            return true;
+        }
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr)
+        {
+            close();
+            return false;
+        }
+        data_ = static_cast<const char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_ == nullptr)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+        }
+        data_ = nullptr;
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+        size_ = 0;
+    }
+#else
+    bool open(const std::string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0)
+        {
+            void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                ::close(fd);
+                size_ = 0;
+                return false;
+            }
+            data_ = static_cast<const char *>(p);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    void close()
+    {
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<char *>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+#endif
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char *data_{nullptr};
+    size_t size_{0};
+#ifdef _WIN32
+    HANDLE file_{INVALID_HANDLE_VALUE};
+    HANDLE mapping_{nullptr};
+#endif
+};
+
+// Static terrain of a board: one byte per cell. Values from kPortalBase up are
+// portal ends; for end id, ends[id] is where it is and exits[id] where it leads.
+struct Level
+{
+    static constexpr uint8_t kEmpty = 0;
+    static constexpr uint8_t kWall = 1;
+    static constexpr uint8_t kPortalBase = 2;
+
+    int w{};
+    int h{};
+    std::vector<uint8_t> cells;
+    std::vector<Vec2> ends;
+    std::vector<Vec2> exits;
+    std::vector<char> portalGlyphs;
+    std::vector<Vec2> spawns;
+
+    uint8_t at(const Vec2 &p) const { return cells[static_cast<size_t>(p.y) * w + p.x]; }
+
+    static Level empty(int w, int h)
+    {
+        Level lv;
+        lv.w = w;
+        lv.h = h;
+        lv.cells.assign(static_cast<size_t>(w) * h, kEmpty);
+        for (int x = 0; x < w; x++)
+        {
+            lv.cells[x] = kWall;
+            lv.cells[static_cast<size_t>(h - 1) * w + x] = kWall;
+        }
+        for (int y = 0; y < h; y++)
+        {
+            lv.cells[static_cast<size_t>(y) * w] = kWall;
+            lv.cells[static_cast<size_t>(y) * w + w - 1] = kWall;
+        }
+        lv.spawns.push_back({std::max(3, w / 2), h / 2});
+        return lv;
+    }
+
+    // Text format, one row per line: '#' wall, ' ' or '.' floor, '@' spawn
+    // point, 'A'..'Z' portals (each letter exactly twice). The outer ring is
+    // always wall.
+    static bool load(const std::string &path, Level &out, std::string &error)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            error = "cannot open level file: " + path;
+            return false;
+        }
+        return parse(file.data(), file.size(), out, error);
+    }
+
+    static bool parse(const char *data, size_t size, Level &out, std::string &error)
+    {
+        int w = 0;
+        int h = 0;
+        for (size_t i = 0, start = 0; i <= size; i++)
+        {
+            if (i == size || data[i] == '\n')
+            {
+                size_t end = i;
+                if (end > start && data[end - 1] == '\r')
+                {
+                    end--;
+                }
+                if (end > start || i < size)
+                {
+                    w = std::max(w, static_cast<int>(end - start));
+                    h++;
+                }
+                start = i + 1;
+            }
+        }
+        if (w < 5 || h < 5)
+        {
+            error = "level must be at least 5x5";
+            return false;
+        }
+
+        Level lv = empty(w, h);
+        lv.spawns.clear();
+        std::array<int, 26> firstEnd{};
+        std::array<int, 26> ends{};
+        int y = 0;
+        int x = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            char c = data[i];
+            if (c == '\n')
+            {
+                y++;
+                x = 0;
+                continue;
+            }
+            if (c == '\r')
+            {
+                continue;
+            }
+            bool border = x == 0 || y == 0 || x == w - 1 || y == h - 1;
+            uint8_t &cell = lv.cells[static_cast<size_t>(y) * w + x];
+            if (c == '#')
+            {
+                cell = kWall;
+            }
+            else if (c == '@' && !border)
+            {
+                lv.spawns.push_back({x, y});
+            }
+            else if (c >= 'A' && c <= 'Z' && !border)
+            {
+                int letter = c - 'A';
+                int id = static_cast<int>(lv.exits.size());
+                if (++ends[letter] > 2)
+                {
+                    error = std::string("portal ") + c + " has more than two ends";
+                    return false;
+                }
+                lv.ends.push_back({x, y});
+                lv.exits.push_back({x, y});
+                lv.portalGlyphs.push_back(c);
+                cell = static_cast<uint8_t>(kPortalBase + id);
+                if (ends[letter] == 1)
+                {
+                    firstEnd[letter] = id;
+                }
+                else
+                {
+                    std::swap(lv.exits[firstEnd[letter]], lv.exits[id]);
+                }
+            }
+            else if (c != ' ' && c != '.' && !border)
+            {
+                error = std::string("unexpected character '") + c + "' at row " + std::to_string(y + 1);
+                return false;
+            }
+            x++;
+        }
+
+        for (int letter = 0; letter < 26; letter++)
+        {
+            if (ends[letter] == 1)
+            {
+                error = std::string("portal ") + static_cast<char>('A' + letter) + " has only one end";
+                return false;
+            }
+        }
+        if (lv.spawns.empty())
+        {
+            lv.spawns.push_back({std::max(3, w / 2), h / 2});
+        }
+        for (const Vec2 &s : lv.spawns)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                if (s.x - k <= 0 || lv.at({s.x - k, s.y}) != kEmpty)
+                {
+                    error = "spawn point at row " + std::to_string(s.y + 1) + " needs two free cells to its left";
+                    return false;
+                }
+            }
+        }
+
+        out = std::move(lv);
+        return true;
+    }
+};
+
+enum class Item : uint8_t
+{
+    Food,
+    SlowDown,
+    SpeedUp,
+    Shrink,
+    Ghost
+};
+
+inline int popcount64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+inline int ctz64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while ((x & 1u) == 0)
+    {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// Index of the highest set bit; x must not be 0.
+inline int msb64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(x);
+#else
+    int n = 0;
+    while (x >>= 1)
+    {
+        n++;
+    }
+    return n;
+#endif
+}
+
+inline void prefetch(const void *p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+inline uint64_t reverse64(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+    x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFull) | ((x & 0x00FF00FF00FF00FFull) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFull) | ((x & 0x0000FFFF0000FFFFull) << 16);
+    return (x >> 32) | (x << 32);
+}
+
+// One bit per cell, bit x of a row in word x / 64. Rows are padded to whole
+// words and padding bits stay zero.
+struct Bitboard
+{
+    int w{};
+    int h{};
+    int stride{};
+    std::vector<uint64_t> words;
+
+    void resize(int width, int height)
+    {
+        w = width;
+        h = height;
+        stride = (width + 63) / 64;
+        words.assign(static_cast<size_t>(stride) * height, 0);
+    }
+
+    uint64_t *row(int y) { return &words[static_cast<size_t>(y) * stride]; }
+    const uint64_t *row(int y) const { return &words[static_cast<size_t>(y) * stride]; }
+
+    bool test(const Vec2 &p) const { return (row(p.y)[p.x >> 6] >> (p.x & 63)) & 1u; }
+    void set(const Vec2 &p) { row(p.y)[p.x >> 6] |= 1ull << (p.x & 63); }
+    void clear(const Vec2 &p) { row(p.y)[p.x >> 6] &= ~(1ull << (p.x & 63)); }
+
+    int count() const
+    {
+        int n = 0;
+        for (uint64_t v : words)
+        {
+            n += popcount64(v);
+        }
+        return n;
+    }
+};
+
+struct Pickup
+{
+    Vec2 pos{};
+    Item item{Item::Food};
+};
+
+// Snake body as a ring buffer of cell indices, head first. Pushing the head and trimming any
+// number of tail segments are index updates; storage only grows (doubling) if
+// the body outgrows the board.
+class Body
+{
+public:
+    void reserve(size_t cells)
+    {
+        size_t cap = 16;
+        while (cap < cells)
+        {
+            cap <<= 1;
+        }
+        buf_.assign(cap, 0);
+        mask_ = cap - 1;
+        head_ = 0;
+        size_ = 0;
+    }
+
+    void clear()
+    {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    void pushFront(int cell)
+    {
+        if (size_ == buf_.size())
+        {
+            grow();
+        }
+        head_ = (head_ - 1) & mask_;
+        buf_[head_] = cell;
+        size_++;
+    }
+
+    void pushBack(int cell)
+    {
+        if (size_ == buf_.size())
+        {
+            grow();
+        }
+        buf_[(head_ + size_) & mask_] = cell;
+        size_++;
+    }
+
+    void trimTail(size_t n) { size_ -= n; }
+
+    // Copies only the live segments.
+    void copyFrom(const Body &o)
+    {
+        if (buf_.size() < o.buf_.size())
+        {
+            buf_.resize(o.buf_.size());
+            mask_ = buf_.size() - 1;
+        }
+        head_ = 0;
+        size_ = o.size_;
+        for (size_t i = 0; i < size_; i++)
+        {
+            buf_[i] = o[i];
+        }
+    }
+
+    int operator[](size_t i) const { return buf_[(head_ + i) & mask_]; }
+    int front() const { return buf_[head_]; }
+    int back() const { return (*this)[size_ - 1]; }
+    size_t size() const { return size_; }
+
+private:
+    std::vector<int> buf_;
+    size_t mask_{0};
+    size_t head_{0};
+    size_t size_{0};
+
+    void grow()
+    {
+        std::vector<int> bigger(buf_.size() * 2);
+        for (size_t i = 0; i < size_; i++)
+        {
+            bigger[i] = (*this)[i];
+        }
+        buf_.swap(bigger);
+        mask_ = buf_.size() - 1;
+        head_ = 0;
+    }
+};
+
+// Why a game ended; None while it runs.
+enum class Death
+{
+    None,
+    Wall,
+    Self
+};
+
+struct Rules
+{
+    bool wrap{false};
+    int foodCount{1};
+    int powerUpChance{20}; // percent per food eaten
+    int effectTicks{60};
+    int shrinkBy{3};
+    int growthPerFood{1};
+};
+
+// Pending effect expirations ordered by tick. Nodes live in a fixed pool and
+// are linked by index, so scheduling never allocates and an idle queue costs
+// one comparison per tick.
+class EffectQueue
+{
+public:
+    static constexpr int kCapacity = 32;
+    static constexpr uint8_t kNil = 0xFF;
+
+    EffectQueue()
+    {
+        for (int i = 0; i < kCapacity; i++)
+        {
+            nodes_[i].next = static_cast<uint8_t>(i + 1 < kCapacity ? i + 1 : kNil);
+        }
+    }
+
+    void clear()
+    {
+        while (head_ != kNil)
+        {
+            (void)pop();
+        }
+    }
+
+    // Returns false when the pool is exhausted.
+    bool push(uint64_t tick, Item effect)
+    {
+        if (free_ == kNil)
+        {
+            return false;
+        }
+        uint8_t n = free_;
+        free_ = nodes_[n].next;
+        nodes_[n].tick = tick;
+        nodes_[n].effect = effect;
+
+        uint8_t *link = &head_;
+        while (*link != kNil && nodes_[*link].tick <= tick)
+        {
+            link = &nodes_[*link].next;
+        }
+        nodes_[n].next = *link;
+        *link = n;
+        return true;
+    }
+
+    bool due(uint64_t tick) const { return head_ != kNil && nodes_[head_].tick <= tick; }
+
+    Item pop()
+    {
+        uint8_t n = head_;
+        head_ = nodes_[n].next;
+        nodes_[n].next = free_;
+        free_ = n;
+        return nodes_[n].effect;
+    }
+
+private:
+    struct Node
+    {
+        uint64_t tick{};
+        Item effect{};
+        uint8_t next{};
+    };
+
+    std::array<Node, kCapacity> nodes_{};
+    uint8_t head_{kNil};
+    uint8_t free_{0};
+};
+
+class Engine
+{
+public:
+    Engine(const Level &level, const Rules &rules, uint64_t seed, uint32_t gameId = 0)
+        : level_(&level), rules_(rules), w_(level.w), h_(level.h), seed_(seed)
+    {
+        // The engine works on linear cell indices (y * width + x). The level's
+        // outer ring is always wall, so that ring is the padding: a move adds
+        // the direction's stride, and one load from warp_ then sends a
+        // wrap-mode border cell to the opposite inner edge and a portal cell to
+        // its exit (identity everywhere else). Keeps the move branch-free.
+        stride_ = {-w_, w_, -1, 1};
+        pos_.resize(static_cast<size_t>(w_) * h_);
+        warp_.resize(pos_.size());
+        for (int y = 0; y < h_; y++)
+        {
+            for (int x = 0; x < w_; x++)
+            {
+                Vec2 to{x, y};
+                if (rules_.wrap)
+                {
+                    to.x = x == 0 ? w_ - 2 : x == w_ - 1 ? 1 : x;
+                    to.y = y == 0 ? h_ - 2 : y == h_ - 1 ? 1 : y;
+                }
+                uint8_t terrain = level_->at(to);
+                if (terrain >= Level::kPortalBase)
+                {
+                    to = level_->exits[terrain - Level::kPortalBase];
+                }
+                pos_[index({x, y})] = {x, y};
+                warp_[index({x, y})] = index(to);
+            }
+        }
+
+        freePos_.assign(static_cast<size_t>(w_) * h_, -1);
+        for (int y = 1; y < h_ - 1; y++)
+        {
+            for (int x = 1; x < w_ - 1; x++)
+            {
+                markFree(index({x, y}));
+            }
+        }
+        emptyFree_ = free_;
+        emptyFreePos_ = freePos_;
+        emptyOcc_.resize(pos_.size());
+        for (size_t c = 0; c < emptyOcc_.size(); c++)
+        {
+            emptyOcc_[c] = level_->cells[c] == Level::kWall ? kWallCell : 0;
+        }
+
+        emptyOpen_.resize(w_, h_);
+        for (int y = 0; y < h_; y++)
+        {
+            for (int x = 0; x < w_; x++)
+            {
+                if (level_->at({x, y}) != Level::kWall)
+                {
+                    emptyOpen_.set({x, y});
+                }
+            }
+        }
+        snake_.reserve(static_cast<size_t>(w_) * h_);
+        reset(gameId);
+    }
+
+    void reset(uint32_t gameId)
+    {
+        gameId_ = gameId;
+        rnd_ = Random(seed_, gameId_);
+        const std::vector<Vec2> &spawns = level_->spawns;
+        int start =
+            index(spawns[Random::range(rnd_.block(0, kSpawnDraw)[0], 0, static_cast<int>(spawns.size()) - 1)]);
+        snake_.clear();
+        snake_.pushBack(start);
+        snake_.pushBack(start - 1);
+        snake_.pushBack(start - 2);
+        growth_ = 0;
+        dir_ = Dir::Right;
+        gameOver_ = false;
+        death_ = Death::None;
+        score_ = 0;
+        tick_ = 0;
+
+        items_.clear();
+        itemAt_.assign(static_cast<size_t>(w_) * h_, -1);
+        powerUps_ = 0;
+        spawned_ = 0;
+        foodDue_ = false;
+        effects_.clear();
+        slow_ = 0;
+        fast_ = 0;
+        ghost_ = 0;
+        occ_ = emptyOcc_;
+        free_ = emptyFree_;
+        freePos_ = emptyFreePos_;
+        open_ = emptyOpen_;
+        for (size_t i = 0; i < snake_.size(); i++)
+        {
+            markTaken(snake_[i]);
+            occ_[snake_[i]] = 1;
+            open_.clear(pos_[snake_[i]]);
+        }
+        for (int i = 0; i < rules_.foodCount; i++)
+        {
+            spawnItem(Item::Food);
+        }
+        itemChangeCount_ = 0;
+    }
+
+    void turn(Dir next)
+    {
+        if (!isOpposite(dir_, next))
+        {
+            dir_ = next;
+        }
+    }
+
+    // Advances one tick; returns true when food was eaten. The replacement
+    // food is placed once the tail has moved; with deferFood it is left to
+    // spawnFood(), or to spawnFoodBatch() for games stepped in lockstep.
+    bool step(bool deferFood = false)
+    {
+        if (gameOver_)
+        {
+            return false;
+        }
+
+        itemChangeCount_ = 0;
+        tick_++;
+        while (effects_.due(tick_))
+        {
+            expire(effects_.pop());
+        }
+
+        int cell = 0;
+        if (!probe(dir_, cell))
+        {
+            gameOver_ = true;
+            death_ = occ_[cell] == kWallCell ? Death::Wall : Death::Self;
+            return false;
+        }
+
+        snake_.pushFront(cell);
+        occ_[cell]++;
+        open_.clear(pos_[cell]);
+        markTaken(cell);
+
+        Item item = Item::Food;
+        bool picked = itemAt_[cell] >= 0;
+        if (picked)
+        {
+            item = items_[itemAt_[cell]].item;
+            removeItem(cell);
+        }
+        bool ate = picked && item == Item::Food;
+        if (ate)
+        {
+            score_ += 10;
+            growth_ += rules_.growthPerFood;
+            foodDue_ = true;
+        }
+        else if (picked)
+        {
+            apply(item);
+        }
+
+        // Spend one unit of the growth budget: a positive budget keeps the
+        // tail in place, a negative one drops an extra segment.
+        size_t trim = 1;
+        if (growth_ > 0)
+        {
+            growth_--;
+            trim = 0;
+        }
+        else if (growth_ < 0)
+        {
+            growth_++;
+            trim = snake_.size() > kMinLength + 1 ? 2 : 1;
+        }
+        trimTail(trim);
+        if (!deferFood)
+        {
+            spawnFood();
+        }
+        return ate;
+    }
+
+    // Places the food owed by a deferred step, if any.
+    void spawnFood()
+    {
+        if (foodDue_)
+        {
+            feed(rnd_.block(tick_, spawned_));
+        }
+    }
+
+    // spawnFood() for many games at once, with identical results. Games go
+    // through in groups of four: a group's Philox blocks are generated
+    // together, the free-list slots they pick are prefetched, and the food is
+    // placed one group later, once those loads have had time to land. With
+    // thousands of boards, placement is bound by cache misses rather than
+    // arithmetic.
+    static void spawnFoodBatch(Engine *const *games, size_t n)
+    {
+        Engine *group[2][4];
+        Philox::Counter ctr[2][4]{};
+        Philox::Key key[4]{};
+        size_t count[2]{};
+        int cur = 0;
+        for (size_t i = 0; i <= n; i++)
+        {
+            if (i < n && games[i]->foodDue_)
+            {
+                size_t k = count[cur]++;
+                group[cur][k] = games[i];
+                ctr[cur][k] = games[i]->rnd_.counter(games[i]->tick_, games[i]->spawned_);
+                key[k] = games[i]->rnd_.key();
+            }
+            if (count[cur] == 4 || i == n)
+            {
+                Philox::generate4(ctr[cur], key);
+                for (size_t g = 0; g < count[cur]; g++)
+                {
+                    group[cur][g]->prefetchPlace(ctr[cur][g]);
+                }
+                cur ^= 1;
+                for (size_t g = 0; g < count[cur]; g++)
+                {
+                    group[cur][g]->feed(ctr[cur][g]);
+                }
+                count[cur] = 0;
+            }
+        }
+        cur ^= 1;
+        for (size_t g = 0; g < count[cur]; g++)
+        {
+            group[cur][g]->feed(ctr[cur][g]);
+        }
+    }
+
+    // Cell reached by stepping from cell in d, after wrap and portals. A wall
+    // is returned as is; callers test it with open() or probe().
+    int neighbor(int cell, Dir d) const { return warp_[cell + stride_[static_cast<int>(d)]]; }
+    Vec2 neighbor(const Vec2 &p, Dir d) const { return pos_[neighbor(index(p), d)]; }
+
+    // Neither wall nor snake.
+    bool open(int cell) const { return occ_[cell] == 0; }
+    bool open(const Vec2 &p) const { return open(index(p)); }
+
+    // Body segments on a non-wall cell; more than one only after ghosting.
+    int segmentsAt(int cell) const { return occ_[cell]; }
+
+    // Cell the head would enter moving in d; false when that move would end
+    // the game.
+    bool probe(Dir d, int &next) const
+    {
+        next = neighbor(snake_.front(), d);
+        uint8_t occ = occ_[next];
+        return occ == 0 || (ghost_ > 0 && occ != kWallCell);
+    }
+
+    bool safe(Dir d) const
+    {
+        int next = 0;
+        return probe(d, next);
+    }
+
+    // Copies the dynamic state of an engine on the same level and rules into
+    // this one, reusing its buffers: cloning a game for lookahead copies flat
+    // arrays and never allocates once warmed up.
+    void copyFrom(const Engine &o)
+    {
+        seed_ = o.seed_;
+        gameId_ = o.gameId_;
+        rnd_ = o.rnd_;
+        snake_.copyFrom(o.snake_);
+        growth_ = o.growth_;
+        items_ = o.items_;
+        itemAt_ = o.itemAt_;
+        powerUps_ = o.powerUps_;
+        spawned_ = o.spawned_;
+        foodDue_ = o.foodDue_;
+        itemChanges_ = o.itemChanges_;
+        itemChangeCount_ = o.itemChangeCount_;
+        free_ = o.free_;
+        freePos_ = o.freePos_;
+        occ_ = o.occ_;
+        open_.words = o.open_.words;
+        effects_ = o.effects_;
+        slow_ = o.slow_;
+        fast_ = o.fast_;
+        ghost_ = o.ghost_;
+        dir_ = o.dir_;
+        gameOver_ = o.gameOver_;
+        death_ = o.death_;
+        score_ = o.score_;
+        tick_ = o.tick_;
+    }
+
+    // Switches future random draws to another seed without touching the
+    // board; planners use it so simulated futures don't see the real food.
+    void reseed(uint64_t seed)
+    {
+        seed_ = seed;
+        rnd_ = Random(seed_, gameId_);
+    }
+
+    static bool isOpposite(Dir a, Dir b)
+    {
+        return opposite(a) == b;
+    }
+
+    // Tick length multiplier from active speed effects, in percent.
+    int tickPercent() const
+    {
+        return std::max(25, std::min(300, 100 + 50 * slow_ - 33 * fast_));
+    }
+
+    // Bit per cell that is neither wall nor snake, kept up to date by step.
+    const Bitboard &openBits() const { return open_; }
+
+    const Level &level() const { return *level_; }
+    const Rules &rules() const { return rules_; }
+    int width() const { return w_; }
+    int height() const { return h_; }
+    uint64_t seed() const { return seed_; }
+    uint32_t gameId() const { return gameId_; }
+    uint64_t tick() const { return tick_; }
+    // Body segments are cell indices; pos() turns one into coordinates.
+    const Body &snake() const { return snake_; }
+    Vec2 pos(int cell) const { return pos_[cell]; }
+    Vec2 head() const { return pos_[snake_.front()]; }
+    int pendingGrowth() const { return growth_; }
+    const std::vector<Pickup> &items() const { return items_; }
+    const Pickup *itemAt(int cell) const { return itemAt_[cell] >= 0 ? &items_[itemAt_[cell]] : nullptr; }
+
+    // Cells where an item was placed or taken since the last step began, so
+    // a renderer can touch only those. A step changes at most three (the
+    // item eaten, its replacement and a power-up); past that, e.g. after a
+    // reset, itemChangesKnown() is false and every item has to be redrawn.
+    bool itemChangesKnown() const { return itemChangeCount_ <= itemChanges_.size(); }
+    size_t itemChangeCount() const { return std::min(itemChangeCount_, itemChanges_.size()); }
+    int itemChange(size_t i) const { return itemChanges_[i]; }
+
+    // Owes one more food to the next spawnFood() without anything eaten,
+    // e.g. to top a board up.
+    void queueFood() { foodDue_ = true; }
+    Dir dir() const { return dir_; }
+    bool gameOver() const { return gameOver_; }
+    Death death() const { return death_; }
+    int score() const { return score_; }
+
+private:
+    static constexpr size_t kMinLength = 3;
+    static constexpr uint32_t kSpawnDraw = 0xFFFFFFFFu;
+    static constexpr uint32_t kPowerUpDraw = 0xFFFFFFFEu;
+    static constexpr uint8_t kWallCell = 0xFF;
+
+    const Level *level_{};
+    Rules rules_;
+    int w_{};
+    int h_{};
+    std::array<int, 4> stride_{};
+    std::vector<Vec2> pos_;
+    std::vector<int> warp_;
+    uint64_t seed_{};
+    uint32_t gameId_{};
+    Random rnd_;
+
+    Body snake_;
+    int growth_{0};
+    // Food and power-ups plus a per-cell slot index (-1 = none) for O(1) eat
+    // checks.
+    std::vector<Pickup> items_;
+    std::vector<int> itemAt_;
+    int powerUps_{0};
+    // Items placed so far this game; the draw number of the next placement.
+    uint32_t spawned_{0};
+    bool foodDue_{false};
+    std::array<int, 4> itemChanges_{};
+    size_t itemChangeCount_{0};
+    // Cells with no terrain, snake or food, and each cell's slot in free_ (-1
+    // when taken). Lets food placement sample uniformly in O(1).
+    std::vector<int> free_;
+    std::vector<int> freePos_;
+    std::vector<int> emptyFree_;
+    std::vector<int> emptyFreePos_;
+    // Segments per cell (more than one only while ghosting), with walls
+    // pre-marked as kWallCell: wall and self collision are one load.
+    std::vector<uint8_t> occ_;
+    std::vector<uint8_t> emptyOcc_;
+    Bitboard open_;
+    Bitboard emptyOpen_;
+
+    EffectQueue effects_;
+    int slow_{0};
+    int fast_{0};
+    int ghost_{0};
+    Dir dir_{Dir::Right};
+    bool gameOver_{false};
+    Death death_{Death::None};
+    int score_{0};
+    uint64_t tick_{0};
+
+    int index(const Vec2 &p) const { return p.y * w_ + p.x; }
+
+    void markFree(int cell)
+    {
+        if (freePos_[cell] < 0 && level_->cells[cell] == Level::kEmpty)
+        {
+            freePos_[cell] = static_cast<int>(free_.size());
+            free_.push_back(cell);
+        }
+    }
+
+    void markTaken(int cell)
+    {
+        int pos = freePos_[cell];
+        if (pos >= 0)
+        {
+            int last = free_.back();
+            free_[pos] = last;
+            freePos_[last] = pos;
+            free_.pop_back();
+            freePos_[cell] = -1;
+        }
+    }
+
+    void removeItem(int cell)
+    {
+        int slot = itemAt_[cell];
+        if (items_[slot].item != Item::Food)
+        {
+            powerUps_--;
+        }
+        Pickup last = items_.back();
+        items_[slot] = last;
+        itemAt_[index(last.pos)] = slot;
+        items_.pop_back();
+        itemAt_[cell] = -1;
+        noteItemChange(cell);
+    }
+
+    void noteItemChange(int cell)
+    {
+        if (itemChangeCount_ < itemChanges_.size())
+        {
+            itemChanges_[itemChangeCount_] = cell;
+        }
+        itemChangeCount_ = std::min(itemChangeCount_ + 1, itemChanges_.size() + 1);
+    }
+
+    // Releases the last n segments' cells, then drops them from the body in
+    // one step.
+    void trimTail(size_t n)
+    {
+        for (size_t i = snake_.size() - n; i < snake_.size(); i++)
+        {
+            int cell = snake_[i];
+            if (--occ_[cell] == 0)
+            {
+                markFree(cell);
+                open_.set(pos_[cell]);
+            }
+        }
+        snake_.trimTail(n);
+    }
+
+    void apply(Item item)
+    {
+        if (item == Item::Shrink)
+        {
+            growth_ -= rules_.shrinkBy;
+            return;
+        }
+        if (!effects_.push(tick_ + static_cast<uint64_t>(rules_.effectTicks), item))
+        {
+            return;
+        }
+        counter(item)++;
+    }
+
+    void expire(Item item)
+    {
+        counter(item)--;
+    }
+
+    int &counter(Item item)
+    {
+        if (item == Item::SlowDown)
+        {
+            return slow_;
+        }
+        if (item == Item::SpeedUp)
+        {
+            return fast_;
+        }
+        return ghost_;
+    }
+
+    // Places the due food from its Philox block, then rolls for a power-up.
+    void feed(const Philox::Counter &bits)
+    {
+        foodDue_ = false;
+        place(Item::Food, bits);
+        if (powerUps_ > 0)
+        {
+            return;
+        }
+        Philox::Counter roll = rnd_.block(tick_, kPowerUpDraw);
+        if (Random::range(roll[0], 0, 99) < rules_.powerUpChance)
+        {
+            spawnItem(static_cast<Item>(Random::range(roll[1], 1, 4)));
+        }
+    }
+
+    void spawnItem(Item item)
+    {
+        place(item, rnd_.block(tick_, spawned_));
+    }
+
+    // Puts item on a uniformly random free cell. Sampling the free list
+    // instead of rejecting occupied cells keeps this O(1) however dense the
+    // board gets.
+    void place(Item item, const Philox::Counter &bits)
+    {
+        spawned_++;
+        if (free_.empty())
+        {
+            return;
+        }
+        int pick = Random::range(bits[0], 0, static_cast<int>(free_.size()) - 1);
+        int cell = free_[pick];
+        markTaken(cell);
+        itemAt_[cell] = static_cast<int>(items_.size());
+        items_.push_back({pos_[cell], item});
+        noteItemChange(cell);
+        if (item != Item::Food)
+        {
+            powerUps_++;
+        }
+    }
+
+    // Touches what place() will read first for this block.
+    void prefetchPlace(const Philox::Counter &bits) const
+    {
+        if (free_.empty())
+        {
+            return;
+        }
+        prefetch(&free_[Random::range(bits[0], 0, static_cast<int>(free_.size()) - 1)]);
+        prefetch(&free_.back());
+        prefetch(items_.data() + items_.size());
+    }
+};
+
+// Reachable-area queries over Engine::openBits(). The fill alternates
+// downward and upward sweeps over the rows: each row takes the reached bits
+// of its neighbour row, then saturates horizontally with a carry-propagating
+// add (and the same on the bit-reversed row for the other direction). A sweep
+// costs O(cells / 64) word operations and open areas settle in one or two
+// sweeps; winding corridors need more. Portal ends are left out of the sweeps
+// since a move onto one lands on its exit: an exit is reached once a cell next
+// to its end is, whether or not the end itself is free, as in Engine::probe.
+class BitFlood
+{
+public:
+    // Number of open cells connected to `from`. `from` itself may be
+    // occupied (e.g. the head); the fill then starts from its open neighbours.
+    int area(const Engine &e, const Vec2 &from)
+    {
+        fill(e, from);
+        return reach_.count();
+    }
+
+    // Reached cells of the last fill.
+    const Bitboard &reached() const { return reach_; }
+
+    void fill(const Engine &e, const Vec2 &from)
+    {
+        const Bitboard &unoccupied = e.openBits();
+        if (reach_.w != unoccupied.w || reach_.h != unoccupied.h)
+        {
+            reach_.resize(unoccupied.w, unoccupied.h);
+            fwd_.assign(static_cast<size_t>(unoccupied.stride), 0);
+            rev_.assign(static_cast<size_t>(unoccupied.stride), 0);
+            revOpen_.assign(static_cast<size_t>(unoccupied.stride), 0);
+        }
+        std::fill(reach_.words.begin(), reach_.words.end(), 0);
+        const Level &level = e.level();
+        const Bitboard *sweep = &unoccupied;
+        if (!level.ends.empty())
+        {
+            passable_ = unoccupied;
+            for (const Vec2 &end : level.ends)
+            {
+                passable_.clear(end);
+            }
+            sweep = &passable_;
+        }
+        const Bitboard &open = *sweep;
+        int lo = open.h;
+        int hi = -1;
+        bool inner = from.x > 0 && from.y > 0 && from.x < open.w - 1 && from.y < open.h - 1;
+        for (int d = -1; d < (inner ? 4 : 0); d++)
+        {
+            Vec2 seed = d < 0 ? from : e.neighbor(from, static_cast<Dir>(d));
+            if (unoccupied.test(seed) && !reach_.test(seed))
+            {
+                reach(open, seed);
+                lo = std::min(lo, seed.y);
+                hi = std::max(hi, seed.y);
+            }
+        }
+        if (hi < 0)
+        {
+            return;
+        }
+
+        bool wrap = e.rules().wrap;
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (int y = std::max(1, lo); y < open.h; y++)
+            {
+                if (!spread(open, y, y - 1))
+                {
+                    if (y > hi)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                changed = true;
+                hi = std::max(hi, y);
+            }
+            for (int y = std::min(open.h - 2, hi); y >= 0; y--)
+            {
+                if (!spread(open, y, y + 1))
+                {
+                    if (y < lo)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                changed = true;
+                lo = std::min(lo, y);
+            }
+            if (wrap && wrapEdges(open))
+            {
+                changed = true;
+                lo = 1;
+                hi = open.h - 2;
+            }
+            for (size_t id = 0; id < level.exits.size(); id++)
+            {
+                const Vec2 &exit = level.exits[id];
+                if (unoccupied.test(exit) && !reach_.test(exit) && nextToReached(e, level.ends[id]))
+                {
+                    reach(open, exit);
+                    changed = true;
+                    lo = std::min(lo, exit.y);
+                    hi = std::max(hi, exit.y);
+                }
+            }
+        }
+    }
+
+private:
+    Bitboard reach_;
+    // Open cells minus portal ends, when the level has portals.
+    Bitboard passable_;
+    std::vector<uint64_t> fwd_;
+    std::vector<uint64_t> rev_;
+    std::vector<uint64_t> revOpen_;
+
+    // Marks p reached and saturates its row. A portal end (an exit, or the
+    // start) is not in open, so its side neighbours are seeded by hand; the
+    // rows above and below take it up through spread().
+    void reach(const Bitboard &open, const Vec2 &p)
+    {
+        bool end = !open.test(p);
+        reach_.set(p);
+        for (int dx = -1; end && dx <= 1; dx += 2)
+        {
+            Vec2 side{p.x + dx, p.y};
+            if (side.x >= 0 && side.x < open.w && open.test(side))
+            {
+                reach_.set(side);
+            }
+        }
+        fillRow(open, p.y);
+    }
+
+    // Whether a move onto `end` can start from a reached cell.
+    bool nextToReached(const Engine &e, const Vec2 &end) const
+    {
+        for (int d = 0; d < 4; d++)
+        {
+            if (reach_.test(e.neighbor(end, static_cast<Dir>(d))))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Pulls reached bits from row `from` into row y and saturates row y.
+    bool spread(const Bitboard &open, int y, int from)
+    {
+        uint64_t *r = reach_.row(y);
+        const uint64_t *src = reach_.row(from);
+        const uint64_t *o = open.row(y);
+        bool grew = false;
+        for (int i = 0; i < open.stride; i++)
+        {
+            uint64_t add = src[i] & o[i] & ~r[i];
+            if (add != 0)
+            {
+                r[i] |= add;
+                grew = true;
+            }
+        }
+        if (grew)
+        {
+            fillRow(open, y);
+        }
+        return grew;
+    }
+
+    // Extends every reached bit of row y to the whole open run around it.
+    void fillRow(const Bitboard &open, int y)
+    {
+        uint64_t *r = reach_.row(y);
+        const uint64_t *o = open.row(y);
+        int n = open.stride;
+        fillUp(r, o, r, n);
+        for (int i = 0; i < n; i++)
+        {
+            rev_[n - 1 - i] = reverse64(r[i]);
+            revOpen_[n - 1 - i] = reverse64(o[i]);
+        }
+        fillUp(rev_.data(), revOpen_.data(), fwd_.data(), n);
+        for (int i = 0; i < n; i++)
+        {
+            r[i] |= reverse64(fwd_[n - 1 - i]);
+        }
+    }
+
+    // For every open run holding a seed bit, sets the bits from the lowest
+    // seed to the top of the run: adding the seeds to the open mask carries
+    // through the run, and the flipped bits are exactly that span. Seed bits
+    // outside the mask (reached portal ends) are kept as they are.
+    static void fillUp(const uint64_t *seed, const uint64_t *o, uint64_t *out, int n)
+    {
+        uint64_t carry = 0;
+        for (int i = 0; i < n; i++)
+        {
+            uint64_t s = seed[i] & o[i];
+            uint64_t t = o[i] + s;
+            uint64_t c1 = t < o[i] ? 1 : 0;
+            uint64_t u = t + carry;
+            uint64_t c2 = u < t ? 1 : 0;
+            carry = c1 | c2;
+            out[i] = ((u ^ o[i]) & o[i]) | seed[i];
+        }
+    }
+
+    // Wrap mode: the inner edge rows and columns are adjacent to their
+    // opposites.
+    bool wrapEdges(const Bitboard &open)
+    {
+        bool changed = false;
+        int top = 1;
+        int bottom = open.h - 2;
+        changed |= spread(open, top, bottom);
+        changed |= spread(open, bottom, top);
+        Vec2 left{1, 0};
+        Vec2 right{open.w - 2, 0};
+        for (int y = 1; y < open.h - 1; y++)
+        {
+            left.y = y;
+            right.y = y;
+            if (reach_.test(left) && open.test(right) && !reach_.test(right))
+            {
+                reach_.set(right);
+                fillRow(open, y);
+                changed = true;
+            }
+            if (reach_.test(right) && open.test(left) && !reach_.test(left))
+            {
+                reach_.set(left);
+                fillRow(open, y);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+};
+
+// BFS distance field over Engine::openBits(), computed a whole layer at a
+// time: the next frontier is the current one shifted one cell in each
+// direction, masked with open and not-yet-visited cells. The board is treated
+// as one flat bit array: shifting across a word boundary moves bits between
+// neighbouring words of a row, and bits never cross between rows because the
+// border columns are walls and never enter the frontier. The frontier buffers
+// have a zero row above and below so the vertical neighbours need no bounds
+// checks. With AVX2 the expansion runs four words per instruction. Moving
+// onto a portal end lands on its partner in one move, as Engine::neighbor
+// does, and BitFlood treats the ends the same way.
+class DistanceField
+{
+public:
+    static constexpr uint32_t kUnreached = 0xFFFFFFFF;
+
+    // Distances from `from` (0 there, even if it is occupied like the head).
+    void compute(const Engine &e, const Vec2 &from)
+    {
+        const Bitboard &open = e.openBits();
+        w_ = open.w;
+        h_ = open.h;
+        stride_ = open.stride;
+        size_t pad = static_cast<size_t>(stride_) + 1;
+        if (seen_.w != open.w || seen_.h != open.h)
+        {
+            seen_.resize(open.w, open.h);
+            size_t n = open.words.size();
+            cur_.assign(n + 2 * pad, 0);
+            next_.assign(n + 2 * pad, 0);
+            dist_.assign(static_cast<size_t>(open.w) * open.h, kUnreached);
+        }
+        std::fill(seen_.words.begin(), seen_.words.end(), 0);
+        layers_ = 0;
+        // Stepping onto a portal end lands on its partner, so the ends are
+        // never entered by a plain shift; extraEdges() moves through them.
+        const uint64_t *passable = open.words.data();
+        const Level &level = e.level();
+        if (!level.ends.empty())
+        {
+            passable_ = open.words;
+            for (const Vec2 &end : level.ends)
+            {
+                passable_[static_cast<size_t>(end.y) * stride_ + (end.x >> 6)] &= ~(1ull << (end.x & 63));
+            }
+            passable = passable_.data();
+        }
+        if (from.x <= 0 || from.y <= 0 || from.x >= open.w - 1 || from.y >= open.h - 1)
+        {
+            return;
+        }
+        seen_.set(from);
+        cur_[pad + static_cast<size_t>(from.y) * stride_ + (from.x >> 6)] = 1ull << (from.x & 63);
+        dist_[static_cast<size_t>(from.y) * w_ + from.x] = 0;
+
+        // Both buffers are zero outside the rows [lo, hi] of the current
+        // frontier, so each layer only touches the band around it.
+        int lo = from.y;
+        int hi = from.y;
+        for (uint32_t k = 1;; k++)
+        {
+            int scanLo = std::max(0, lo - 1);
+            int scanHi = std::min(h_ - 1, hi + 1);
+            bool grew = expand(&cur_[pad], &next_[pad], passable, seen_.words.data(),
+                               static_cast<size_t>(scanLo) * stride_, static_cast<size_t>(scanHi + 1) * stride_,
+                               stride_);
+            grew |= extraEdges(e, &cur_[pad], &next_[pad], scanLo, scanHi);
+            clearRows(&cur_[pad], lo, hi);
+            if (!grew)
+            {
+                break;
+            }
+            layers_ = static_cast<int>(k);
+            record(&next_[pad], scanLo, scanHi, k, lo, hi);
+            cur_.swap(next_);
+        }
+    }
+
+    // BFS distance, or -1 if unreachable.
+    int at(const Vec2 &p) const
+    {
+        return seen_.test(p) ? static_cast<int>(dist_[static_cast<size_t>(p.y) * w_ + p.x]) : -1;
+    }
+
+    const Bitboard &reached() const { return seen_; }
+    int layers() const { return layers_; }
+
+private:
+    Bitboard seen_;
+    std::vector<uint64_t> cur_;
+    std::vector<uint64_t> next_;
+    std::vector<uint64_t> passable_;
+    std::vector<uint32_t> dist_;
+    int w_{0};
+    int h_{0};
+    int stride_{0};
+    int layers_{0};
+
+    // next = neighbours(cur) & open & ~seen and seen |= next, over words
+    // [begin, end). Returns whether anything was added.
+    static bool expand(const uint64_t *cur, uint64_t *next, const uint64_t *open, uint64_t *seen, size_t begin,
+                       size_t end, int stride)
+    {
+        size_t i = begin;
+        uint64_t any = 0;
+#if defined(__AVX2__)
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 4 <= end; i += 4)
+        {
+            __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur + i));
+            __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur + i - 1));
+            __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur + i + 1));
+            __m256i up = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur + i - stride));
+            __m256i down = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur + i + stride));
+            __m256i grow = _mm256_or_si256(_mm256_or_si256(up, down),
+                                           _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(f, 1),
+                                                                           _mm256_srli_epi64(lo, 63)),
+                                                           _mm256_or_si256(_mm256_srli_epi64(f, 1),
+                                                                           _mm256_slli_epi64(hi, 63))));
+            __m256i o = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(open + i));
+            __m256i sn = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(seen + i));
+            __m256i add = _mm256_andnot_si256(sn, _mm256_and_si256(grow, o));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(next + i), add);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(seen + i), _mm256_or_si256(sn, add));
+            acc = _mm256_or_si256(acc, add);
+        }
+        any = _mm256_testz_si256(acc, acc) ? 0 : 1;
+#endif
+        for (; i < end; i++)
+        {
+            uint64_t f = cur[i];
+            uint64_t grow = cur[i - stride] | cur[i + stride] | (f << 1) | (cur[i - 1] >> 63) | (f >> 1) |
+                            (cur[i + 1] << 63);
+            uint64_t add = grow & open[i] & ~seen[i];
+            next[i] = add;
+            seen[i] |= add;
+            any |= add;
+        }
+        return any != 0;
+    }
+
+    // Adjacency the flat shifts cannot see: wrap-mode edges and portals,
+    // each one move as in Engine::neighbor (a move onto a portal end lands on
+    // its partner). Widens [scanLo, scanHi] to cover rows it adds to.
+    bool extraEdges(const Engine &e, const uint64_t *cur, uint64_t *next, int &scanLo, int &scanHi)
+    {
+        const Bitboard &open = e.openBits();
+        const Level &level = e.level();
+        bool grew = false;
+        auto link = [&](const Vec2 &a, Vec2 b) {
+            uint8_t terrain = level.at(b);
+            if (terrain >= Level::kPortalBase)
+            {
+                b = level.exits[terrain - Level::kPortalBase];
+            }
+            size_t wa = static_cast<size_t>(a.y) * stride_ + (a.x >> 6);
+            if (((cur[wa] >> (a.x & 63)) & 1u) && open.test(b) && !seen_.test(b))
+            {
+                seen_.set(b);
+                next[static_cast<size_t>(b.y) * stride_ + (b.x >> 6)] |= 1ull << (b.x & 63);
+                scanLo = std::min(scanLo, b.y);
+                scanHi = std::max(scanHi, b.y);
+                grew = true;
+            }
+        };
+        if (e.rules().wrap)
+        {
+            for (int x = 1; x < open.w - 1; x++)
+            {
+                link({x, 1}, {x, open.h - 2});
+                link({x, open.h - 2}, {x, 1});
+            }
+            for (int y = 1; y < open.h - 1; y++)
+            {
+                link({1, y}, {open.w - 2, y});
+                link({open.w - 2, y}, {1, y});
+            }
+        }
+        for (const Vec2 &end : level.ends)
+        {
+            for (const Vec2 &d : kDirDelta)
+            {
+                link({end.x - d.x, end.y - d.y}, end);
+            }
+        }
+        return grew;
+    }
+
+    void clearRows(uint64_t *buf, int lo, int hi)
+    {
+        std::fill(buf + static_cast<size_t>(lo) * stride_, buf + static_cast<size_t>(hi + 1) * stride_, 0);
+    }
+
+    // Stores distance k for every bit of the new layer and returns its rows.
+    void record(const uint64_t *layer, int scanLo, int scanHi, uint32_t k, int &lo, int &hi)
+    {
+        lo = h_;
+        hi = -1;
+        for (int y = scanLo; y <= scanHi; y++)
+        {
+            for (int wi = 0; wi < stride_; wi++)
+            {
+                uint64_t bits = layer[static_cast<size_t>(y) * stride_ + wi];
+                if (bits == 0)
+                {
+                    continue;
+                }
+                lo = std::min(lo, y);
+                hi = std::max(hi, y);
+                size_t base = static_cast<size_t>(y) * w_ + static_cast<size_t>(wi) * 64;
+                while (bits != 0)
+                {
+                    dist_[base + ctz64(bits)] = k;
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+};
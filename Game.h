@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Agents.h"
+#include "Engine.h"
+#include "Leaderboard.h"
+#include "Replay.h"
+#include "Scene.h"
+#include "Terminal.h"
+
+enum class RenderMode
+{
+    Diff, // only changed runs of cells
+    Full, // whole frame every time, for comparing against Diff
+    None  // no output; the loop, input and frame building still run
+};
+
+struct GameConfig
+{
+    int tickMs{110};
+    int minTickMs{55};
+    int speedupMs{2}; // tick shortening per food eaten
+    RenderMode render{RenderMode::Diff};
+    ThemeStyle theme{ThemeStyle::Box};
+    bool smooth{false}; // half-cell motion between ticks
+    bool focusPause{true}; // freeze while the terminal is unfocused
+};
+
+class Game
+{
+public:
+    Game(const Level &level, const Rules &rules, const GameConfig &config, uint64_t seed,
+         std::unique_ptr<Agent> agent = nullptr)
+        : w_(level.w), h_(level.h), config_(config), engine_(level, rules, seed), agent_(std::move(agent)),
+          input_(), render_(level.w, level.h, Theme(config.theme)), scene_(level), tickMs_(config.tickMs)
+    {
+    }
+
+    // Saves each game as a Replay to path when it ends (or on quit).
+    // levelPath is what the replay will load the level from; empty for the
+    // default board.
+    void recordTo(const std::string &path, const std::string &levelPath)
+    {
+        recordPath_ = path;
+        replay_.levelPath = levelPath;
+        replay_.width = w_;
+        replay_.height = h_;
+        startRecording();
+    }
+
+    // Adds every finished game to board under the given player name.
+    void keepScores(Leaderboard &board, const std::string &player)
+    {
+        scores_ = &board;
+        player_ = player;
+        best_ = board.best();
+    }
+
+    int run()
+    {
+        using clock = std::chrono::steady_clock;
+        auto last = clock::now();
+
+        while (!quit_)
+        {
+            handleInput();
+            if (config_.focusPause && !input_.focused())
+            {
+                // Nothing ticks or draws until the terminal has focus again;
+                // the tick resumes where it was.
+                auto paused = clock::now();
+                while (!quit_ && !input_.focused())
+                {
+                    input_.wait();
+                    handleInput();
+                }
+                last += clock::now() - paused;
+                continue;
+            }
+            auto now = clock::now();
+            auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(now - last);
+            if (dt.count() >= tickMs_ * engine_.tickPercent() / 100)
+            {
+                if (agent_ && !engine_.gameOver() && !decided_)
+                {
+                    engine_.turn(agent_->decide(engine_));
+                }
+                decided_ = false;
+                if (!recordPath_.empty() && !engine_.gameOver())
+                {
+                    replay_.record(engine_);
+                }
+                if (engine_.step())
+                {
+                    tickMs_ = std::max(config_.minTickMs, tickMs_ - config_.speedupMs);
+                }
+                if (engine_.gameOver())
+                {
+                    saveRecording();
+                    saveScore();
+                }
+                last = now;
+                dt = std::chrono::milliseconds::zero();
+            }
+            double progress = static_cast<double>(dt.count()) / std::max(1, tickMs_ * engine_.tickPercent() / 100);
+            if (config_.smooth && progress >= 0.5 && agent_ && !decided_ && !engine_.gameOver())
+            {
+                // The head's half step shows the coming turn, so the
+                // autopilot makes it now instead of when the tick fires.
+                engine_.turn(agent_->decide(engine_));
+                decided_ = true;
+            }
+            drawFrame(progress);
+            std::this_thread::sleep_for(std::chrono::milliseconds(8));
+        }
+        saveRecording();
+        if (scores_ != nullptr && (!scores_->flush() || scoreFailed_))
+        {
+            std::cerr << "cannot write the score log\n";
+        }
+        return 0;
+    }
+
+private:
+    int w_{};
+    int h_{};
+    GameConfig config_;
+    Engine engine_;
+    std::unique_ptr<Agent> agent_;
+    Input input_;
+    Renderer render_;
+    Scene scene_;
+
+    bool quit_{false};
+    int tickMs_{};
+    std::string recordPath_;
+    Replay replay_;
+    bool recorded_{false};
+    Leaderboard *scores_{nullptr};
+    std::string player_;
+    int best_{-1};
+    bool scored_{false};
+    bool scoreFailed_{false}; // reported on exit, not over the board
+    bool decided_{false};     // the agent already turned for the coming tick
+
+    void reset()
+    {
+        engine_.reset(engine_.gameId() + 1);
+        quit_ = false;
+        tickMs_ = config_.tickMs;
+        scored_ = false;
+        decided_ = false;
+        startRecording();
+    }
+
+    void saveScore()
+    {
+        if (scores_ == nullptr || scored_)
+        {
+            return;
+        }
+        scored_ = true;
+        ScoreEntry e;
+        e.score = engine_.score();
+        e.ticks = static_cast<uint32_t>(engine_.tick());
+        e.seed = engine_.seed();
+        e.time = static_cast<int64_t>(std::time(nullptr));
+        std::memcpy(e.name.data(), player_.data(), std::min(player_.size(), e.name.size()));
+        // A game ends rarely, so write it now rather than leave it to a
+        // batch that Ctrl-C or a crash would lose.
+        if (!scores_->add(e) || !scores_->flush())
+        {
+            scoreFailed_ = true;
+        }
+        best_ = std::max(best_, e.score);
+    }
+
+    void startRecording()
+    {
+        replay_.rules = engine_.rules();
+        replay_.seed = engine_.seed();
+        replay_.gameId = engine_.gameId();
+        replay_.turns.clear();
+        recorded_ = false;
+    }
+
+    void saveRecording()
+    {
+        if (recordPath_.empty() || recorded_)
+        {
+            return;
+        }
+        replay_.ticks = engine_.tick();
+        replay_.score = engine_.score();
+        recorded_ = true;
+        if (!replay_.save(recordPath_))
+        {
+            std::cerr << "cannot write " << recordPath_ << "\n";
+        }
+    }
+
+    void handleInput()
+    {
+        char c = input_.pollKey();
+        if (c == 0)
+        {
+            return;
+        }
+
+        if (c == 'q' || c == 'Q')
+        {
+            quit_ = true;
+            return;
+        }
+        if ((c == 'r' || c == 'R') && engine_.gameOver())
+        {
+            reset();
+            return;
+        }
+
+        int next = kKeyDirs[static_cast<uint8_t>(c)];
+        if (next >= 0)
+        {
+            engine_.turn(static_cast<Dir>(next));
+        }
+    }
+
+    // progress: fraction of the current tick already elapsed.
+    void drawFrame(double progress)
+    {
+        if (!config_.smooth)
+        {
+            progress = 0.0;
+        }
+        if (config_.render == RenderMode::None)
+        {
+            scene_.build(engine_, best_, progress);
+            return;
+        }
+        if (config_.render == RenderMode::Full)
+        {
+            render_.invalidate();
+        }
+        render_.draw(scene_.build(engine_, best_, progress));
+    }
+};
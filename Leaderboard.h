@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Engine.h"
+
+// CRC-32 (IEEE, reflected), table-driven.
+inline uint32_t crc32(const void *data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+    {
+        c = table[(c ^ p[i]) & 0xFFu] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+struct ScoreEntry
+{
+    int32_t score{};
+    uint32_t ticks{};
+    uint64_t seed{};
+    int64_t time{}; // unix seconds
+    std::array<char, 16> name{};
+
+    std::string player() const { return std::string(name.data(), strnlen(name.data(), name.size())); }
+};
+
+// High scores kept in an append-only log of fixed 48-byte records, each with
+// a magic and a CRC, so a write torn by a crash is skipped on the next load
+// and never corrupts the records around it. Several sessions can append to
+// one file at once (O_APPEND, whole records per write).
+//
+// Appends are buffered and made durable in batches: one write + fsync per
+// kBatch records or per kBatchMs, and on flush(). Loading maps the log and
+// builds a compact index of (score, record) sorted by score; entries added
+// since then live in a multiset overlay. Insert is O(log n) and top(n) walks
+// both in order, O(n).
+class Leaderboard
+{
+public:
+    Leaderboard() = default;
+    Leaderboard(const Leaderboard &) = delete;
+    Leaderboard &operator=(const Leaderboard &) = delete;
+    ~Leaderboard() { close(); }
+
+    bool open(const std::string &path, std::string &error)
+    {
+        close();
+        path_ = path;
+        if (!openAppend())
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        return reload(error);
+    }
+
+    // Re-reads the log, picking up what other sessions appended.
+    bool reload(std::string &error)
+    {
+        flush();
+        map_.close();
+        index_.clear();
+        recent_.clear();
+        skipped_ = 0;
+        if (!map_.open(path_))
+        {
+            error = "cannot read " + path_;
+            return false;
+        }
+        const char *data = map_.data();
+        size_t size = map_.size();
+        size_t off = 0;
+        while (off + kRecord <= size)
+        {
+            ScoreEntry e;
+            if (!decode(data + off, e))
+            {
+                // Torn or foreign bytes: resynchronise on the next record.
+                skipped_++;
+                off = resync(data, size, off + 1);
+                continue;
+            }
+            index_.push_back({e.score, static_cast<uint64_t>(off)});
+            off += kRecord;
+        }
+        std::sort(index_.begin(), index_.end(),
+                  [](const Slot &a, const Slot &b) { return a.score != b.score ? a.score > b.score : a.off < b.off; });
+        return true;
+    }
+
+    // Queues e; the batch is written once it is full or a second old.
+    // Returns false if that write failed.
+    bool add(const ScoreEntry &e)
+    {
+        recent_.insert(e);
+        char rec[kRecord];
+        encode(e, rec);
+        pending_.append(rec, kRecord);
+        auto now = std::chrono::steady_clock::now();
+        if (pending_.size() == kRecord)
+        {
+            batchStart_ = now;
+        }
+        if (pending_.size() >= kBatch * kRecord || now - batchStart_ >= std::chrono::milliseconds(kBatchMs))
+        {
+            return flush();
+        }
+        return true;
+    }
+
+    // Writes and fsyncs everything added so far.
+    bool flush()
+    {
+        if (pending_.empty())
+        {
+            return true;
+        }
+        bool ok = writeAll(pending_.data(), pending_.size()) && sync();
+        pending_.clear();
+        return ok;
+    }
+
+    // Best n entries, highest score first.
+    std::vector<ScoreEntry> top(size_t n) const
+    {
+        std::vector<ScoreEntry> out;
+        out.reserve(std::min(n, size()));
+        size_t i = 0;
+        auto r = recent_.begin();
+        while (out.size() < n && (i < index_.size() || r != recent_.end()))
+        {
+            if (r != recent_.end() && (i == index_.size() || r->score > index_[i].score))
+            {
+                out.push_back(*r++);
+            }
+            else
+            {
+                ScoreEntry e;
+                decode(map_.data() + index_[i++].off, e);
+                out.push_back(e);
+            }
+        }
+        return out;
+    }
+
+    int best() const
+    {
+        std::vector<ScoreEntry> t = top(1);
+        return t.empty() ? 0 : t[0].score;
+    }
+
+    size_t size() const { return index_.size() + recent_.size(); }
+    // Damaged regions passed over by the last load.
+    size_t skipped() const { return skipped_; }
+
+    void close()
+    {
+        flush();
+        map_.close();
+#ifdef _WIN32
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+        }
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+        fd_ = -1;
+#endif
+    }
+
+private:
+    static constexpr size_t kRecord = 48;
+    static constexpr size_t kBatch = 256;
+    static constexpr int kBatchMs = 1000;
+    static constexpr uint32_t kMagic = 0x314B4E53u; // "SNK1"
+
+    struct Slot
+    {
+        int32_t score;
+        uint64_t off;
+    };
+
+    struct ByScore
+    {
+        bool operator()(const ScoreEntry &a, const ScoreEntry &b) const { return a.score > b.score; }
+    };
+
+    std::string path_;
+    MappedFile map_;
+    std::vector<Slot> index_;
+    std::multiset<ScoreEntry, ByScore> recent_;
+    std::string pending_;
+    std::chrono::steady_clock::time_point batchStart_;
+    size_t skipped_{0};
+#ifdef _WIN32
+    HANDLE file_{INVALID_HANDLE_VALUE};
+#else
+    int fd_{-1};
+#endif
+
+    // magic, crc of the remaining 40 bytes, score, ticks, seed, time, name;
+    // host byte order.
+    static void encode(const ScoreEntry &e, char *rec)
+    {
+        std::memcpy(rec, &kMagic, 4);
+        std::memcpy(rec + 8, &e.score, 4);
+        std::memcpy(rec + 12, &e.ticks, 4);
+        std::memcpy(rec + 16, &e.seed, 8);
+        std::memcpy(rec + 24, &e.time, 8);
+        std::memcpy(rec + 32, e.name.data(), 16);
+        uint32_t crc = crc32(rec + 8, kRecord - 8);
+        std::memcpy(rec + 4, &crc, 4);
+    }
+
+    static bool decode(const char *rec, ScoreEntry &e)
+    {
+        uint32_t magic = 0;
+        uint32_t crc = 0;
+        std::memcpy(&magic, rec, 4);
+        std::memcpy(&crc, rec + 4, 4);
+        if (magic != kMagic || crc != crc32(rec + 8, kRecord - 8))
+        {
+            return false;
+        }
+        std::memcpy(&e.score, rec + 8, 4);
+        std::memcpy(&e.ticks, rec + 12, 4);
+        std::memcpy(&e.seed, rec + 16, 8);
+        std::memcpy(&e.time, rec + 24, 8);
+        std::memcpy(e.name.data(), rec + 32, 16);
+        return true;
+    }
+
+    static size_t resync(const char *data, size_t size, size_t off)
+    {
+        ScoreEntry e;
+        for (; off + kRecord <= size; off++)
+        {
+            if (std::memcmp(data + off, &kMagic, 4) == 0 && decode(data + off, e))
+            {
+                return off;
+            }
+        }
+        return size;
+    }
+
+#ifdef _WIN32
+    bool openAppend()
+    {
+        file_ = CreateFileA(path_.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+        return file_ != INVALID_HANDLE_VALUE;
+    }
+
+    bool writeAll(const char *p, size_t n)
+    {
+        DWORD written = 0;
+        return WriteFile(file_, p, static_cast<DWORD>(n), &written, nullptr) && written == n;
+    }
+
+    bool sync() { return FlushFileBuffers(file_) != 0; }
+#else
+    bool openAppend()
+    {
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        return fd_ >= 0;
+    }
+
+    // One write per batch: with O_APPEND the batch lands contiguously even
+    // when other sessions append at the same time.
+    bool writeAll(const char *p, size_t n)
+    {
+        while (n > 0)
+        {
+            ssize_t w = ::write(fd_, p, n);
+            if (w < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (w <= 0)
+            {
+                return false;
+            }
+            p += w;
+            n -= static_cast<size_t>(w);
+        }
+        return true;
+    }
+
+    bool sync() { return fsync(fd_) == 0; }
+#endif
+};
@@ -0,0 +1,1178 @@
+#include "Modes.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "Leaderboard.h"
+#include "Replay.h"
+#include "Scene.h"
+#include "Terminal.h"
+
+namespace replay
+{
+int run(const std::vector<std::string> &paths)
+{
+    uint64_t ticks = 0;
+    size_t bytes = 0;
+    int failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string &path : paths)
+    {
+        Replay rp;
+        Level level;
+        std::string error;
+        if (!rp.load(path, error) || !rp.makeLevel(level, error))
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        Engine engine(level, rp.rules, rp.seed, rp.gameId);
+        Scene scene(level);
+        Renderer render(level.w, level.h);
+        size_t next = 0;
+        bytes += render.encode(scene.build(engine)).size();
+        while (!engine.gameOver() && engine.tick() < rp.ticks)
+        {
+            while (next < rp.turns.size() && rp.turns[next].tick == engine.tick())
+            {
+                engine.turn(rp.turns[next++].dir);
+            }
+            engine.step();
+            bytes += render.encode(scene.build(engine)).size();
+        }
+        ticks += engine.tick();
+        bool ok = engine.tick() == rp.ticks && engine.score() == rp.score;
+        failed += ok ? 0 : 1;
+        std::cout << path << ": " << engine.tick() << " ticks, score " << engine.score()
+                  << (ok ? "" : "  DESYNC, recorded " + std::to_string(rp.ticks) + " ticks, score " +
+                                    std::to_string(rp.score))
+                  << "\n";
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << ticks << " ticks in " << std::fixed << std::setprecision(0) << secs * 1e3 << " ms, "
+              << ticks / secs << " ticks/s, " << bytes / std::max<uint64_t>(ticks, 1) << " bytes/frame\n";
+    return failed == 0 ? 0 : 1;
+}
+} // namespace replay
+
+namespace train
+{
+double gaussian(FastRng &rng)
+{
+    double u1 = (static_cast<double>(rng.next() >> 11) + 1.0) * 0x1.0p-53;
+    double u2 = static_cast<double>(rng.next() >> 11) * 0x1.0p-53;
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+}
+
+int run(const Level &level, const Rules &rules, const Config &config)
+{
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    size_t games = static_cast<size_t>(config.population) * config.seeds;
+    std::vector<Genome> population(config.population);
+    std::vector<double> results(games);
+    std::vector<std::pair<double, int>> ranking(config.population);
+    std::vector<std::unique_ptr<Engine>> engines(pool.size());
+    std::vector<HeuristicAgent> agents(pool.size());
+    FastRng rng(0xC0FFEE);
+    for (size_t i = 1; i < population.size(); i++)
+    {
+        for (double &v : population[i].w)
+        {
+            v += config.sigma * 4 * gaussian(rng);
+        }
+    }
+
+    for (int gen = 0; gen < config.generations; gen++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        pool.run(games, [&](size_t job, unsigned worker) {
+            std::unique_ptr<Engine> &engine = engines[worker];
+            uint32_t seed = static_cast<uint32_t>(job % config.seeds) + 1;
+            if (!engine)
+            {
+                engine = std::make_unique<Engine>(level, rules, seed);
+            }
+            engine->reseed(seed);
+            engine->reset(0);
+            HeuristicAgent &agent = agents[worker];
+            agent.setGenome(population[job / config.seeds]);
+            while (!engine->gameOver() && engine->tick() < static_cast<uint64_t>(config.maxTicks))
+            {
+                engine->turn(agent.decide(*engine));
+                engine->step();
+            }
+            results[job] = engine->score() + engine->tick() / 100.0;
+        });
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (int i = 0; i < config.population; i++)
+        {
+            double sum = 0;
+            for (int k = 0; k < config.seeds; k++)
+            {
+                sum += results[static_cast<size_t>(i) * config.seeds + k];
+            }
+            ranking[i] = {sum / config.seeds, i};
+        }
+        std::sort(ranking.begin(), ranking.end(), std::greater<>());
+        const Genome &best = population[ranking[0].second];
+        if (!best.save(config.out))
+        {
+            std::cerr << "cannot write " << config.out << "\n";
+            return 1;
+        }
+        std::cout << "gen " << gen << "  best " << std::fixed << std::setprecision(1) << ranking[0].first << "  "
+                  << std::setprecision(0) << games / secs << " games/s  [";
+        for (int k = 0; k < Genome::kSize; k++)
+        {
+            std::cout << (k ? " " : "") << std::setprecision(3) << best.w[k];
+        }
+        std::cout << "]" << std::endl;
+
+        std::vector<Genome> next;
+        next.reserve(population.size());
+        for (int i = 0; i < config.elite && i < config.population; i++)
+        {
+            next.push_back(population[ranking[i].second]);
+        }
+        while (next.size() < population.size())
+        {
+            int a = static_cast<int>(rng.next() % population.size());
+            int b = static_cast<int>(rng.next() % population.size());
+            // ranking is sorted, so the lower rank index wins the tournament
+            Genome child = population[ranking[std::min(a, b)].second];
+            for (double &v : child.w)
+            {
+                v += config.sigma * gaussian(rng);
+            }
+            next.push_back(child);
+        }
+        population.swap(next);
+    }
+    return 0;
+}
+} // namespace train
+
+namespace stats
+{
+// Log-linear histogram over fixed storage: exact below 16, then 16 buckets
+// per power of two (values within 1/16 of each other share a bucket). Adding
+// never allocates, and merging is element-wise addition.
+struct Histogram
+{
+    static constexpr int kSub = 16;
+    std::array<uint64_t, kSub * 61> counts{};
+    uint64_t n{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+
+    void add(uint64_t v)
+    {
+        counts[bucket(v)]++;
+        n++;
+        sum += v;
+        max = std::max(max, v);
+    }
+
+    void merge(const Histogram &o)
+    {
+        for (size_t i = 0; i < counts.size(); i++)
+        {
+            counts[i] += o.counts[i];
+        }
+        n += o.n;
+        sum += o.sum;
+        max = std::max(max, o.max);
+    }
+
+    // Lower edge of the bucket holding the p-quantile.
+    uint64_t quantile(double p) const
+    {
+        uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(n));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++)
+        {
+            seen += counts[i];
+            if (seen > rank)
+            {
+                return low(static_cast<int>(i));
+            }
+        }
+        return max;
+    }
+
+    double mean() const { return n ? static_cast<double>(sum) / static_cast<double>(n) : 0.0; }
+
+    static int bucket(uint64_t v)
+    {
+        if (v < kSub)
+        {
+            return static_cast<int>(v);
+        }
+        int shift = msb64(v) - 4;
+        return (shift + 1) * kSub + static_cast<int>((v >> shift) - kSub);
+    }
+
+    static uint64_t low(int i)
+    {
+        if (i < kSub)
+        {
+            return static_cast<uint64_t>(i);
+        }
+        int shift = i / kSub - 1;
+        return static_cast<uint64_t>(i % kSub + kSub) << shift;
+    }
+};
+
+// Packed per-game row of the binary output, after an 8-byte header "SSTA"
+// plus a u32 version.
+struct Row
+{
+    uint32_t game;
+    int32_t score;
+    uint32_t ticks;
+    uint32_t length;
+    uint32_t death;
+};
+
+int run(const Level &level, const Rules &rules, const Config &config,
+        const std::function<std::unique_ptr<Agent>()> &makeAgent)
+{
+    struct Worker
+    {
+        std::unique_ptr<Engine> engine;
+        std::unique_ptr<Agent> agent;
+        Histogram score;
+        Histogram length;
+        Histogram ticks;
+        std::array<uint64_t, 3> deaths{};
+        std::string buf;
+    };
+    const size_t kFlush = 64 * 1024;
+
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<Worker> workers(pool.size());
+    for (Worker &w : workers)
+    {
+        w.engine = std::make_unique<Engine>(level, rules, config.seed);
+        w.agent = makeAgent();
+        if (!w.agent)
+        {
+            return 1;
+        }
+        w.buf.reserve(kFlush + 256);
+    }
+
+    bool csv = config.out.size() >= 4 && config.out.compare(config.out.size() - 4, 4, ".csv") == 0;
+    std::ofstream out;
+    std::mutex outLock;
+    if (!config.out.empty())
+    {
+        out.open(config.out, std::ios::binary | std::ios::trunc);
+        if (csv)
+        {
+            out << "game,score,length,ticks,death\n";
+        }
+        else
+        {
+            uint32_t version = 1;
+            out.write("SSTA", 4);
+            out.write(reinterpret_cast<const char *>(&version), 4);
+        }
+        if (!out)
+        {
+            std::cerr << "cannot write " << config.out << "\n";
+            return 1;
+        }
+    }
+    auto drain = [&](Worker &w) {
+        std::lock_guard<std::mutex> lock(outLock);
+        out.write(w.buf.data(), static_cast<std::streamsize>(w.buf.size()));
+        w.buf.clear();
+    };
+
+    // Indexed by Death; a game still alive at the end hit the tick limit.
+    static const char *const kDeaths[] = {"limit", "wall", "self"};
+    auto start = std::chrono::steady_clock::now();
+    pool.run(static_cast<size_t>(config.games), [&](size_t job, unsigned id) {
+        Worker &w = workers[id];
+        Engine &e = *w.engine;
+        e.reset(static_cast<uint32_t>(job));
+        while (!e.gameOver() && (config.maxTicks == 0 || e.tick() < config.maxTicks))
+        {
+            e.turn(w.agent->decide(e));
+            e.step();
+        }
+        Row row{static_cast<uint32_t>(job), e.score(), static_cast<uint32_t>(e.tick()),
+                static_cast<uint32_t>(e.snake().size()), static_cast<uint32_t>(e.death())};
+        w.score.add(static_cast<uint64_t>(row.score));
+        w.length.add(row.length);
+        w.ticks.add(row.ticks);
+        w.deaths[row.death]++;
+        if (!out.is_open())
+        {
+            return;
+        }
+        if (csv)
+        {
+            char line[96];
+            char *p = line;
+            for (uint32_t v : {row.game, static_cast<uint32_t>(row.score), row.length, row.ticks})
+            {
+                p = std::to_chars(p, line + sizeof(line), v).ptr;
+                *p++ = ',';
+            }
+            size_t len = std::strlen(kDeaths[row.death]);
+            std::memcpy(p, kDeaths[row.death], len);
+            p += len;
+            *p++ = '\n';
+            w.buf.append(line, static_cast<size_t>(p - line));
+        }
+        else
+        {
+            w.buf.append(reinterpret_cast<const char *>(&row), sizeof(row));
+        }
+        if (w.buf.size() >= kFlush)
+        {
+            drain(w);
+        }
+    });
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Worker &total = workers[0];
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        Worker &w = workers[i];
+        if (out.is_open() && !w.buf.empty())
+        {
+            drain(w);
+        }
+        if (i == 0)
+        {
+            continue;
+        }
+        total.score.merge(w.score);
+        total.length.merge(w.length);
+        total.ticks.merge(w.ticks);
+        for (size_t k = 0; k < total.deaths.size(); k++)
+        {
+            total.deaths[k] += w.deaths[k];
+        }
+    }
+    if (out.is_open() && !out.flush())
+    {
+        std::cerr << "cannot write " << config.out << "\n";
+        return 1;
+    }
+
+    std::cout << config.games << " games on " << pool.size() << " threads in " << std::fixed << std::setprecision(2)
+              << secs << " s: " << std::setprecision(0) << config.games / secs << " games/s, "
+              << total.ticks.sum / secs << " ticks/s\n";
+    std::cout << std::left << std::setw(10) << "" << std::right;
+    for (const char *h : {"mean", "p50", "p90", "p99", "max"})
+    {
+        std::cout << std::setw(10) << h;
+    }
+    std::cout << "\n";
+    auto line = [](const char *name, const Histogram &h) {
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(10) << std::setprecision(1)
+                  << h.mean();
+        for (double p : {0.5, 0.9, 0.99})
+        {
+            std::cout << std::setw(10) << h.quantile(p);
+        }
+        std::cout << std::setw(10) << h.max << "\n";
+    };
+    line("score", total.score);
+    line("length", total.length);
+    line("ticks", total.ticks);
+    std::cout << "death    ";
+    for (size_t k = 0; k < total.deaths.size(); k++)
+    {
+        std::cout << "  " << kDeaths[k] << " " << std::setprecision(1)
+                  << 100.0 * static_cast<double>(total.deaths[k]) / config.games << "%";
+    }
+    std::cout << "\n";
+    return 0;
+}
+} // namespace stats
+
+namespace bench
+{
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::time_point since)
+{
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+void report(const std::string &name, double count, const char *unit, double secs, const std::string &note = "")
+{
+    double rate = count / secs;
+    const char *scale = rate >= 1e6 ? " M" : rate >= 1e3 ? " k" : " ";
+    rate /= rate >= 1e6 ? 1e6 : rate >= 1e3 ? 1e3 : 1;
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << rate << scale << unit << "/s  (" << std::setprecision(0) << secs * 1e3 << " ms)"
+              << note << "\n";
+}
+
+// Random walk that restarts on death; measures raw Engine::step cost.
+void stepThroughput(const std::string &name, const Level &level, const Rules &rules, uint64_t steps)
+{
+    Engine engine(level, rules, 1);
+    FastRng rng(7);
+    uint32_t games = 0;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < steps; i++)
+    {
+        engine.turn(static_cast<Dir>(rng.next() & 3));
+        engine.step();
+        if (engine.gameOver())
+        {
+            engine.reset(++games);
+        }
+    }
+    report(name, static_cast<double>(steps), "steps", seconds(start), "  " + std::to_string(games) + " games");
+}
+
+// Plays each benchmark seed with the agent until death or maxTicks.
+void agentGames(const std::string &name, Agent &agent, const Level &level, const Rules &rules, int seeds,
+                int maxTicks)
+{
+    long total = 0;
+    long ticks = 0;
+    auto start = Clock::now();
+    for (int seed = 1; seed <= seeds; seed++)
+    {
+        Engine engine(level, rules, static_cast<uint64_t>(seed));
+        while (!engine.gameOver() && engine.tick() < static_cast<uint64_t>(maxTicks))
+        {
+            engine.turn(agent.decide(engine));
+            engine.step();
+        }
+        total += engine.score();
+        ticks += static_cast<long>(engine.tick());
+    }
+    report(name, static_cast<double>(ticks), "moves", seconds(start),
+           "  avg score " + std::to_string(total / seeds) + " over " + std::to_string(seeds) + " seeds");
+}
+
+void mcts(const Level &level)
+{
+    MctsConfig config;
+    config.playouts = 1000;
+    MctsAgent agent(config);
+    agentGames("mcts/games", agent, level, Rules{}, 4, 400);
+    report("mcts/playouts", static_cast<double>(agent.playouts()), "playouts", agent.searchSeconds(),
+           "  " + std::to_string(config.threads) + " threads");
+}
+
+// Queue-based flood fill, the baseline for BitFlood.
+int scalarArea(const Engine &e, const Vec2 &from, std::vector<uint8_t> &seen, std::vector<Vec2> &queue)
+{
+    seen.assign(static_cast<size_t>(e.width()) * e.height(), 0);
+    queue.clear();
+    for (int d = -1; d < 4; d++)
+    {
+        Vec2 p = d < 0 ? from : e.neighbor(from, static_cast<Dir>(d));
+        uint8_t &mark = seen[static_cast<size_t>(p.y) * e.width() + p.x];
+        if (!mark && e.open(p))
+        {
+            mark = 1;
+            queue.push_back(p);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        for (int d = 0; d < 4; d++)
+        {
+            Vec2 n = e.neighbor(queue[i], static_cast<Dir>(d));
+            uint8_t &mark = seen[static_cast<size_t>(n.y) * e.width() + n.x];
+            if (!mark && e.open(n))
+            {
+                mark = 1;
+                queue.push_back(n);
+            }
+        }
+    }
+    return static_cast<int>(queue.size());
+}
+
+Level obstacleBoard(int wallPercent, uint64_t seed)
+{
+    Level level = Level::empty(256, 256);
+    FastRng rng(seed);
+    for (int y = 1; y < level.h - 1; y++)
+    {
+        for (int x = 1; x < level.w - 1; x++)
+        {
+            if (static_cast<int>(rng.next() % 100) < wallPercent)
+            {
+                level.cells[static_cast<size_t>(y) * level.w + x] = Level::kWall;
+            }
+        }
+    }
+    Vec2 spawn = level.spawns[0];
+    for (int k = 0; k < 3; k++)
+    {
+        level.cells[static_cast<size_t>(spawn.y) * level.w + spawn.x - k] = Level::kEmpty;
+    }
+    return level;
+}
+
+// Reachable-area queries from random cells, bitboard vs queue fill.
+void flood(int wallPercent)
+{
+    Level level = obstacleBoard(wallPercent, 11);
+    Engine engine(level, Rules{}, 1);
+    FastRng rng(3);
+    std::vector<Vec2> queries(512);
+    for (Vec2 &q : queries)
+    {
+        q = {1 + static_cast<int>(rng.next() % 254), 1 + static_cast<int>(rng.next() % 254)};
+    }
+    std::string name = "flood256/walls" + std::to_string(wallPercent) + "%";
+    BitFlood bits;
+    long check = 0;
+    auto start = Clock::now();
+    for (const Vec2 &q : queries)
+    {
+        check += bits.area(engine, q);
+    }
+    report(name + "/bitboard", static_cast<double>(queries.size()), "queries", seconds(start));
+    std::vector<uint8_t> seen;
+    std::vector<Vec2> queue;
+    start = Clock::now();
+    for (const Vec2 &q : queries)
+    {
+        check -= scalarArea(engine, q, seen, queue);
+    }
+    report(name + "/scalar", static_cast<double>(queries.size()), "queries", seconds(start),
+           check == 0 ? "" : "  MISMATCH");
+}
+
+// Random walk over a 256x256 board with wallPercent walls and 20% of the
+// rest covered by body, moving only into free cells: the collision test the
+// engine makes every tick, done three ways. bounds = coordinate bounds check
+// plus terrain and body loads; split = terrain and body loads on a linear
+// index; sentinel = one load from an occupancy grid with walls pre-marked.
+void collide(int wallPercent)
+{
+    const uint64_t kSteps = 20000000;
+    Level level = obstacleBoard(wallPercent, 13);
+    int w = level.w;
+    std::vector<uint8_t> body(level.cells.size(), 0);
+    std::vector<uint8_t> occ(level.cells.size(), 0);
+    FastRng fill(17);
+    for (size_t c = 0; c < occ.size(); c++)
+    {
+        if (level.cells[c] == Level::kWall)
+        {
+            occ[c] = 0xFF;
+        }
+        else if (fill.next() % 100 < 20)
+        {
+            body[c] = 1;
+            occ[c] = 1;
+        }
+    }
+    Vec2 spawn = level.spawns[0];
+    int start = spawn.y * w + spawn.x;
+    body[start] = 0;
+    occ[start] = 0;
+    const std::array<int, 4> stride{-w, w, -1, 1};
+    std::string name = "collide256/walls" + std::to_string(wallPercent) + "%";
+
+    auto walk = [&](const char *variant, auto step) {
+        FastRng rng(23);
+        int cell = start;
+        long blocked = 0;
+        auto begin = Clock::now();
+        for (uint64_t i = 0; i < kSteps; i++)
+        {
+            int d = static_cast<int>(rng.next() & 3);
+            int next = step(cell, d);
+            blocked += next == cell;
+            cell = next;
+        }
+        report(name + "/" + variant, static_cast<double>(kSteps), "steps", seconds(begin),
+               "  blocked " + std::to_string(blocked));
+    };
+    walk("bounds", [&](int cell, int d) {
+        Vec2 p{cell % w + kDirDelta[d].x, cell / w + kDirDelta[d].y};
+        if (p.x <= 0 || p.x >= w - 1 || p.y <= 0 || p.y >= level.h - 1 || level.at(p) == Level::kWall ||
+            body[static_cast<size_t>(p.y) * w + p.x] != 0)
+        {
+            return cell;
+        }
+        return p.y * w + p.x;
+    });
+    walk("split", [&](int cell, int d) {
+        int next = cell + stride[d];
+        return level.cells[next] == Level::kWall || body[next] != 0 ? cell : next;
+    });
+    walk("sentinel", [&](int cell, int d) {
+        int next = cell + stride[d];
+        return occ[next] != 0 ? cell : next;
+    });
+}
+
+// Full-frame encodes of a 256x256 board (20% walls, a third of the floor
+// covered by body pieces and items) per theme, in cells per microsecond.
+// The baseline is the per-cell C-string append the table copy replaced.
+void encode()
+{
+    Level level = obstacleBoard(20, 29);
+    Engine engine(level, Rules{}, 1);
+    Scene scene(level);
+    std::vector<std::string> frame = scene.build(engine);
+    FastRng rng(31);
+    for (int y = 1; y < level.h - 1; y++)
+    {
+        for (int x = 1; x < level.w - 1; x++)
+        {
+            if (level.at({x, y}) == Level::kEmpty && rng.next() % 3 == 0)
+            {
+                frame[y][x] = static_cast<char>(kGlyphBase + rng.next() % (kGlyphGhost - kGlyphBase + 1));
+            }
+        }
+    }
+    const int kFrames = 100;
+    double cells = static_cast<double>(level.w) * level.h * kFrames;
+    size_t expect = 0;
+    for (ThemeStyle style : {ThemeStyle::Ascii, ThemeStyle::Box, ThemeStyle::Color})
+    {
+        Renderer render(level.w, level.h, Theme(style));
+        size_t bytes = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < kFrames; i++)
+        {
+            render.invalidate();
+            bytes += render.encode(frame).size();
+        }
+        double secs = seconds(start);
+        const char *name = style == ThemeStyle::Ascii ? "encode/ascii"
+                           : style == ThemeStyle::Box ? "encode/box"
+                                                      : "encode/color";
+        report(name, cells, "cells", secs, "  " + std::to_string(bytes / kFrames) + " bytes/frame");
+        expect = style == ThemeStyle::Box ? bytes : expect;
+    }
+
+    Theme box(ThemeStyle::Box);
+    std::array<std::string, 256> strings;
+    for (int c = 0; c < 256; c++)
+    {
+        const Theme::Entry &e = box[static_cast<uint8_t>(c)];
+        strings[c].assign(e.bytes.data(), e.len);
+    }
+    std::array<const char *, 256> table;
+    for (int c = 0; c < 256; c++)
+    {
+        table[c] = strings[c].c_str();
+    }
+    std::string out;
+    size_t bytes = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < kFrames; i++)
+    {
+        out.clear();
+        out += "\x1b[2J";
+        for (size_t y = 0; y < frame.size(); y++)
+        {
+            out += "\x1b[" + std::to_string(y + 1) + ";1H";
+            for (char c : frame[y])
+            {
+                out += table[static_cast<uint8_t>(c)];
+            }
+        }
+        out += "\x1b[" + std::to_string(frame.size() + 1) + ";1H";
+        bytes += out.size();
+    }
+    report("encode/box-strings", cells, "cells", seconds(start), bytes == expect ? "" : "  MISMATCH");
+}
+
+// Build + diff-encode cost of a frame on the default board while the
+// heuristic agent plays: one frame per tick, then eight per tick with half-
+// cell motion (about the terminal loop's rate at a 55-110 ms tick).
+void frames()
+{
+    Level level = Level::empty(50, 22);
+    for (int perTick : {1, 8})
+    {
+        Engine engine(level, Rules{}, 3);
+        HeuristicAgent agent;
+        Scene scene(level);
+        Renderer render(level.w, level.h);
+        size_t bytes = 0;
+        long count = 0;
+        double secs = 0;
+        while (!engine.gameOver() && engine.tick() < 3000)
+        {
+            engine.turn(agent.decide(engine));
+            engine.step();
+            auto start = Clock::now();
+            for (int k = 0; k < perTick; k++)
+            {
+                bytes += render.encode(scene.build(engine, 0, perTick == 1 ? 0.0 : k / 8.0)).size();
+            }
+            secs += seconds(start);
+            count += perTick;
+        }
+        report(perTick == 1 ? "frame/tick" : "frame/smooth8", static_cast<double>(count), "frames", secs,
+               "  " + std::to_string(static_cast<int>(secs / count * 1e9)) + " ns, " +
+                   std::to_string(bytes / count) + " bytes each");
+    }
+}
+
+void scalarDistances(const Engine &e, const Vec2 &from, std::vector<int> &dist, std::vector<Vec2> &queue)
+{
+    dist.assign(static_cast<size_t>(e.width()) * e.height(), -1);
+    queue.clear();
+    queue.push_back(from);
+    dist[static_cast<size_t>(from.y) * e.width() + from.x] = 0;
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        int d = dist[static_cast<size_t>(queue[i].y) * e.width() + queue[i].x];
+        for (int k = 0; k < 4; k++)
+        {
+            Vec2 n = e.neighbor(queue[i], static_cast<Dir>(k));
+            int &slot = dist[static_cast<size_t>(n.y) * e.width() + n.x];
+            if (slot < 0 && e.open(n))
+            {
+                slot = d + 1;
+                queue.push_back(n);
+            }
+        }
+    }
+}
+
+// Full distance fields from random cells, bit-parallel layers vs queue BFS.
+void distance(int wallPercent)
+{
+    Level level = obstacleBoard(wallPercent, 11);
+    Engine engine(level, Rules{}, 1);
+    FastRng rng(3);
+    std::vector<Vec2> queries(256);
+    for (Vec2 &q : queries)
+    {
+        q = {1 + static_cast<int>(rng.next() % 254), 1 + static_cast<int>(rng.next() % 254)};
+    }
+    std::string name = "distance256/walls" + std::to_string(wallPercent) + "%";
+    DistanceField field;
+    long layers = 0;
+    auto start = Clock::now();
+    for (const Vec2 &q : queries)
+    {
+        field.compute(engine, q);
+        layers += field.layers();
+    }
+#if defined(__AVX2__)
+    const char *kernel = "/avx2";
+#else
+    const char *kernel = "/scalar-bits";
+#endif
+    report(name + kernel, static_cast<double>(queries.size()), "fields", seconds(start),
+           "  " + std::to_string(layers / static_cast<long>(queries.size())) + " layers avg");
+    std::vector<int> dist;
+    std::vector<Vec2> queue;
+    start = Clock::now();
+    for (const Vec2 &q : queries)
+    {
+        scalarDistances(engine, q, dist, queue);
+    }
+    report(name + "/queue", static_cast<double>(queries.size()), "fields", seconds(start));
+}
+
+// Food placement in 4096 games whose boards are fillPercent covered in food,
+// one game at a time with spawnFood() and in lockstep with spawnFoodBatch().
+// Both place exactly the same cells; the batch-spawn test holds them to it.
+void spawn(int fillPercent)
+{
+    Level level = Level::empty(48, 48);
+    Rules rules;
+    rules.powerUpChance = 0;
+    rules.foodCount = std::max(1, (level.w - 2) * (level.h - 2) * fillPercent / 100);
+    std::vector<Engine> games;
+    std::vector<Engine> batch;
+    std::vector<Engine *> ptrs;
+    games.reserve(4096);
+    batch.reserve(4096);
+    for (uint32_t g = 0; g < 4096; g++)
+    {
+        games.emplace_back(level, rules, 1, g);
+        batch.emplace_back(level, rules, 1, g);
+        ptrs.push_back(&batch.back());
+    }
+    const int rounds = 64;
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (Engine &e : games)
+        {
+            e.queueFood();
+            e.spawnFood();
+        }
+    }
+    double single = seconds(start);
+    start = Clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (Engine *e : ptrs)
+        {
+            e->queueFood();
+        }
+        Engine::spawnFoodBatch(ptrs.data(), ptrs.size());
+    }
+    double batched = seconds(start);
+    double spawns = static_cast<double>(rounds) * games.size();
+    std::string name = "spawn/fill" + std::to_string(fillPercent) + "%";
+    report(name + "/single", spawns, "spawns", single);
+    report(name + "/batch", spawns, "spawns", batched);
+}
+
+// Leaderboard with a million entries: batched appends, the index rebuild a
+// new session pays on open, then top-N queries against index plus overlay.
+void scores()
+{
+    // In the temp directory, not wherever the bench happens to run (the
+    // bench target runs in the source tree).
+    std::error_code ec;
+    const std::string path = (std::filesystem::temp_directory_path(ec) / "snake-bench.scores").string();
+    std::remove(path.c_str());
+    const int entries = 1000000;
+    FastRng rng(11);
+    Leaderboard board;
+    std::string error;
+    if (!board.open(path, error))
+    {
+        std::cerr << error << "\n";
+        return;
+    }
+    ScoreEntry e;
+    std::memcpy(e.name.data(), "bench", 5);
+    auto start = Clock::now();
+    for (int i = 0; i < entries; i++)
+    {
+        e.score = static_cast<int32_t>(rng.next() % 100000);
+        e.seed = static_cast<uint64_t>(i);
+        board.add(e);
+    }
+    board.flush();
+    report("scores/add", entries, "entries", seconds(start));
+
+    start = Clock::now();
+    board.reload(error);
+    report("scores/open", entries, "entries", seconds(start));
+
+    for (int i = 0; i < 1000; i++)
+    {
+        e.score = static_cast<int32_t>(rng.next() % 100000);
+        board.add(e);
+    }
+    const int queries = 20000;
+    size_t sink = 0;
+    start = Clock::now();
+    for (int q = 0; q < queries; q++)
+    {
+        sink += board.top(10).size();
+    }
+    report("scores/top10", queries, "queries", seconds(start));
+    start = Clock::now();
+    for (int q = 0; q < queries / 100; q++)
+    {
+        sink += board.top(1000).size();
+    }
+    report("scores/top1000", queries / 100, "queries", seconds(start),
+           sink == 0 ? "  empty" : "  " + std::to_string(board.size()) + " entries");
+    board.close();
+    std::remove(path.c_str());
+}
+
+// Decision latency of the MLP policy, one game at a time and in batches of
+// 256 games positioned by random walks.
+void mlp(const Level &level)
+{
+    MlpPolicy policy;
+    policy.randomize(32, 99);
+    MlpAgent agent(policy);
+    std::vector<Engine> games;
+    FastRng rng(5);
+    for (uint32_t g = 0; g < 256; g++)
+    {
+        games.emplace_back(level, Rules{}, g + 1);
+        for (uint64_t i = rng.next() % 20; i > 0 && !games.back().gameOver(); i--)
+        {
+            games.back().step();
+        }
+    }
+    std::vector<Dir> out(games.size());
+    const int rounds = 4000;
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (const Engine &e : games)
+        {
+            out[0] = agent.decide(e);
+        }
+    }
+    double single = seconds(start);
+    start = Clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        agent.decideBatch(games.data(), games.size(), out.data());
+    }
+    double batched = seconds(start);
+    double decisions = static_cast<double>(rounds) * games.size();
+    report("mlp/decide", decisions, "decisions", single,
+           "  " + std::to_string(static_cast<int>(single / decisions * 1e9)) + " ns each");
+    report("mlp/decide-batch256", decisions, "decisions", batched,
+           "  " + std::to_string(static_cast<int>(batched / decisions * 1e9)) + " ns each");
+}
+
+// The compare chains the direction tables replaced, kept as the baseline.
+Vec2 chainMove(Vec2 p, Dir d)
+{
+    if (d == Dir::Up)
+    {
+        p.y -= 1;
+    }
+    if (d == Dir::Down)
+    {
+        p.y += 1;
+    }
+    if (d == Dir::Left)
+    {
+        p.x -= 1;
+    }
+    if (d == Dir::Right)
+    {
+        p.x += 1;
+    }
+    return p;
+}
+
+bool chainOpposite(Dir a, Dir b)
+{
+    return (a == Dir::Up && b == Dir::Down) || (a == Dir::Down && b == Dir::Up) ||
+           (a == Dir::Left && b == Dir::Right) || (a == Dir::Right && b == Dir::Left);
+}
+
+int chainKey(char c)
+{
+    if (c == 'w' || c == 'W')
+    {
+        return 0;
+    }
+    if (c == 's' || c == 'S')
+    {
+        return 1;
+    }
+    if (c == 'a' || c == 'A')
+    {
+        return 2;
+    }
+    if (c == 'd' || c == 'D')
+    {
+        return 3;
+    }
+    return -1;
+}
+
+// Turn-and-move over 4096 games in lockstep with random turns (the
+// unpredictable case for branches), and key decoding of random WASD input.
+void direction()
+{
+    const size_t kGames = 4096;
+    const int kRounds = 2000;
+    FastRng rng(5);
+    std::vector<Dir> turns(kGames * 61);
+    for (Dir &d : turns)
+    {
+        d = static_cast<Dir>(rng.next() & 3);
+    }
+    auto simulate = [&](const char *name, auto move, auto reverses) {
+        std::vector<Vec2> heads(kGames, Vec2{32, 16});
+        std::vector<Dir> dirs(kGames, Dir::Right);
+        size_t t = 0;
+        auto start = Clock::now();
+        for (int r = 0; r < kRounds; r++)
+        {
+            for (size_t g = 0; g < kGames; g++)
+            {
+                Dir next = turns[t];
+                t = t + 1 == turns.size() ? 0 : t + 1;
+                if (!reverses(dirs[g], next))
+                {
+                    dirs[g] = next;
+                }
+                Vec2 p = move(heads[g], dirs[g]);
+                heads[g] = {p.x & 63, p.y & 31};
+            }
+        }
+        double secs = seconds(start);
+        long sum = 0;
+        for (const Vec2 &p : heads)
+        {
+            sum += p.x + p.y;
+        }
+        report(name, static_cast<double>(kRounds) * kGames, "moves", secs, "  check " + std::to_string(sum));
+    };
+    simulate("dir/move-branches", chainMove, chainOpposite);
+    simulate("dir/move-table", [](Vec2 p, Dir d) { return Vec2{p.x + delta(d).x, p.y + delta(d).y}; },
+             Engine::isOpposite);
+
+    std::vector<char> keys(1 << 16);
+    const char pool[] = "wasdWASDqx ";
+    for (char &c : keys)
+    {
+        c = pool[rng.next() % (sizeof(pool) - 1)];
+    }
+    auto decode = [&](const char *name, auto key) {
+        long sum = 0;
+        auto start = Clock::now();
+        for (int r = 0; r < kRounds; r++)
+        {
+            for (char c : keys)
+            {
+                sum += key(c);
+            }
+        }
+        report(name, static_cast<double>(kRounds) * keys.size(), "keys", seconds(start),
+               "  check " + std::to_string(sum));
+    };
+    decode("dir/key-branches", chainKey);
+    decode("dir/key-table", [](char c) { return static_cast<int>(kKeyDirs[static_cast<uint8_t>(c)]); });
+}
+
+const std::vector<std::string> &groups()
+{
+    static const std::vector<std::string> names{"step", "dir",   "encode", "frame",  "collide",  "mcts",
+                                                "mlp",  "flood", "spawn",  "scores", "distance", "heuristic"};
+    return names;
+}
+
+int run(const std::string &only)
+{
+    Level level = Level::empty(50, 22);
+    if (only.empty() || only == "step")
+    {
+        Rules walls;
+        Rules wrap;
+        wrap.wrap = true;
+        stepThroughput("step/walls", level, walls, 20000000);
+        stepThroughput("step/wrap", level, wrap, 20000000);
+        Rules dense = wrap;
+        dense.foodCount = 400;
+        stepThroughput("step/wrap-food400", level, dense, 2000000);
+    }
+    if (only.empty() || only == "dir")
+    {
+        direction();
+    }
+    if (only.empty() || only == "encode")
+    {
+        encode();
+    }
+    if (only.empty() || only == "frame")
+    {
+        frames();
+    }
+    if (only.empty() || only == "collide")
+    {
+        collide(0);
+        collide(20);
+    }
+    if (only.empty() || only == "mcts")
+    {
+        mcts(level);
+    }
+    if (only.empty() || only == "mlp")
+    {
+        mlp(level);
+    }
+    if (only.empty() || only == "flood")
+    {
+        flood(0);
+        flood(20);
+        flood(40);
+    }
+    if (only.empty() || only == "spawn")
+    {
+        spawn(0);
+        spawn(50);
+        spawn(90);
+    }
+    if (only.empty() || only == "scores")
+    {
+        scores();
+    }
+    if (only.empty() || only == "distance")
+    {
+        distance(0);
+        distance(20);
+    }
+    if (only.empty() || only == "heuristic")
+    {
+        HeuristicAgent agent;
+        agentGames("heuristic/games", agent, level, Rules{}, 8, 2000);
+    }
+    return 0;
+}
+} // namespace bench
+
+namespace headless
+{
+int run(const Level &level, const std::string &levelPath, const Rules &rules, uint64_t seed, Agent &agent,
+        int games, uint64_t maxTicks, const std::string &recordPath)
+{
+    Engine engine(level, rules, seed);
+    long total = 0;
+    uint64_t ticks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int g = 0; g < games; g++)
+    {
+        engine.reset(static_cast<uint32_t>(g));
+        Replay replay;
+        replay.levelPath = levelPath;
+        replay.width = level.w;
+        replay.height = level.h;
+        replay.rules = rules;
+        replay.seed = seed;
+        replay.gameId = static_cast<uint32_t>(g);
+        while (!engine.gameOver() && (maxTicks == 0 || engine.tick() < maxTicks))
+        {
+            engine.turn(agent.decide(engine));
+            replay.record(engine);
+            engine.step();
+        }
+        total += engine.score();
+        ticks += engine.tick();
+        std::cout << "game " << g << ": score " << engine.score() << ", " << engine.tick() << " ticks"
+                  << (engine.gameOver() ? "" : " (tick limit)") << "\n";
+        if (g == 0 && !recordPath.empty())
+        {
+            replay.ticks = engine.tick();
+            replay.score = engine.score();
+            if (!replay.save(recordPath))
+            {
+                std::cerr << "cannot write " << recordPath << "\n";
+                return 1;
+            }
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "seed " << seed << ", mean score " << std::fixed << std::setprecision(1)
+              << static_cast<double>(total) / games << ", " << std::setprecision(0) << ticks / secs << " ticks/s\n";
+    return 0;
+}
+} // namespace headless
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Agents.h"
+#include "Engine.h"
+
+// Everything the program can do besides the terminal game; main picks one
+// from the command line.
+
+namespace replay
+{
+// Plays recorded games back as fast as possible, building and encoding every
+// frame the way the terminal game would, and checks each against its recorded
+// result. Covers the step and render hot paths, which makes it the PGO
+// training run.
+int run(const std::vector<std::string> &paths);
+} // namespace replay
+
+namespace train
+{
+struct Config
+{
+    int generations{20};
+    int population{32};
+    int elite{4};
+    int seeds{4};
+    int maxTicks{2000};
+    double sigma{0.3};
+    std::string out{"best.genome"};
+};
+
+// Evolves HeuristicAgent weights: every genome plays the same fixed seeds,
+// games are spread over a ThreadPool, the top `elite` survive unchanged and
+// the rest are mutated copies of tournament winners. The best genome is
+// written to `out` after every generation.
+int run(const Level &level, const Rules &rules, const Config &config);
+} // namespace train
+
+namespace stats
+{
+struct Config
+{
+    int games{100000};
+    uint64_t seed{1};
+    uint64_t maxTicks{100000};
+    // Per-game rows go here: CSV when the name ends in .csv, binary otherwise.
+    std::string out;
+};
+
+// Plays config.games games (ids 0..games-1 of one seed) across all cores.
+// Each worker owns an engine, an agent, its histograms and an output buffer,
+// all set up before the first game, so the game loop never allocates. Rows
+// are streamed to the output in 64 KiB chunks; histograms are merged at the
+// end.
+int run(const Level &level, const Rules &rules, const Config &config,
+        const std::function<std::unique_ptr<Agent>()> &makeAgent);
+} // namespace stats
+
+namespace bench
+{
+// Names run() accepts for its only argument.
+const std::vector<std::string> &groups();
+
+// Runs the benchmark group named by only, or all of them when it is empty.
+int run(const std::string &only);
+
+// 256x256 board with `wallPercent` random walls.
+Level obstacleBoard(int wallPercent, uint64_t seed);
+
+// Queue flood fill, the baseline for BitFlood: open cells reachable from
+// `from` (or from its open neighbours when it is occupied).
+int scalarArea(const Engine &e, const Vec2 &from, std::vector<uint8_t> &seen, std::vector<Vec2> &queue);
+
+// Queue BFS distances, the baseline for DistanceField.
+void scalarDistances(const Engine &e, const Vec2 &from, std::vector<int> &dist, std::vector<Vec2> &queue);
+} // namespace bench
+
+namespace headless
+{
+// Plays `games` games with the agent at full speed and no terminal, game ids
+// 0..games-1 of one seed. The first game is recorded if recordPath is set.
+int run(const Level &level, const std::string &levelPath, const Rules &rules, uint64_t seed, Agent &agent,
+        int games, uint64_t maxTicks, const std::string &recordPath);
+} // namespace headless
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Engine.h"
+
+// Everything needed to play a game again: level, rules, seed and the
+// direction changes with the tick they were made at. The engine is
+// deterministic given these, so the recorded result doubles as a checksum.
+struct Replay
+{
+    struct Turn
+    {
+        uint64_t tick{};
+        Dir dir{Dir::Right};
+    };
+
+    // Level file, or empty for Level::empty(width, height). Relative to the
+    // working directory here, but to the replay's own directory in the file,
+    // so a recording plays back from anywhere.
+    std::string levelPath;
+    int width{50};
+    int height{22};
+    Rules rules;
+    uint64_t seed{};
+    uint32_t gameId{};
+    std::vector<Turn> turns;
+    uint64_t ticks{};
+    int score{};
+
+    // Call before every step; stores the direction when it changed.
+    void record(const Engine &e)
+    {
+        Dir last = turns.empty() ? Dir::Right : turns.back().dir;
+        if (e.dir() != last)
+        {
+            turns.push_back({e.tick(), e.dir()});
+        }
+    }
+
+    // The level path runs to the end of its line, so it may contain spaces
+    // but not line breaks.
+    bool save(const std::string &path) const
+    {
+        if (levelPath.find_first_of("\r\n") != std::string::npos)
+        {
+            return false;
+        }
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            out << "snake-replay 1\n";
+            if (levelPath.empty())
+            {
+                out << "board " << width << " " << height << "\n";
+            }
+            else
+            {
+                out << "level " << relativeTo(levelPath, path) << "\n";
+            }
+            out << "rules " << rules.wrap << " " << rules.foodCount << " " << rules.growthPerFood << "\n";
+            out << "seed " << seed << " " << gameId << "\n";
+            out << "result " << ticks << " " << score << "\n";
+            out << "turns " << turns.size() << "\n";
+            for (const Turn &t : turns)
+            {
+                out << t.tick << " " << kDirs[static_cast<int>(t.dir)] << "\n";
+            }
+            if (!out)
+            {
+                return false;
+            }
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    bool load(const std::string &path, std::string &error)
+    {
+        std::ifstream in(path);
+        Replay r;
+        std::string tag;
+        int version = 0;
+        size_t count = 0;
+        bool ok = in >> tag >> version && tag == "snake-replay" && version == 1 && in >> tag;
+        if (ok && tag == "board")
+        {
+            ok = static_cast<bool>(in >> r.width >> r.height);
+        }
+        else if (ok && tag == "level")
+        {
+            ok = in.get() == ' ' && std::getline(in, r.levelPath) && !r.levelPath.empty();
+            if (ok && r.levelPath.back() == '\r')
+            {
+                r.levelPath.pop_back();
+            }
+            if (ok && std::filesystem::path(r.levelPath).is_relative())
+            {
+                r.levelPath = (std::filesystem::path(path).parent_path() / r.levelPath).lexically_normal().string();
+            }
+        }
+        else
+        {
+            ok = false;
+        }
+        ok = ok && in >> tag >> r.rules.wrap >> r.rules.foodCount >> r.rules.growthPerFood && tag == "rules";
+        ok = ok && in >> tag >> r.seed >> r.gameId && tag == "seed";
+        ok = ok && in >> tag >> r.ticks >> r.score && tag == "result";
+        ok = ok && in >> tag >> count && tag == "turns";
+        for (size_t i = 0; ok && i < count; i++)
+        {
+            Turn t;
+            char d = 0;
+            ok = in >> t.tick >> d && std::strchr(kDirs, d) != nullptr && d != 0;
+            t.dir = static_cast<Dir>(ok ? std::strchr(kDirs, d) - kDirs : 0);
+            r.turns.push_back(t);
+        }
+        if (!ok)
+        {
+            error = path + ": not a valid replay";
+            return false;
+        }
+        // Same limits as --size, --food and --grow; the engine assumes them.
+        if (r.levelPath.empty() && (r.width < 8 || r.width > 4096 || r.height < 6 || r.height > 4096))
+        {
+            error = path + ": board " + std::to_string(r.width) + "x" + std::to_string(r.height) +
+                    " is outside 8x6 to 4096x4096";
+            return false;
+        }
+        if (r.rules.foodCount < 1 || r.rules.foodCount > 100000 || r.rules.growthPerFood < 0 ||
+            r.rules.growthPerFood > 1000)
+        {
+            error = path + ": rules out of range (food 1 to 100000, growth 0 to 1000)";
+            return false;
+        }
+        *this = std::move(r);
+        return true;
+    }
+
+    bool makeLevel(Level &out, std::string &error) const
+    {
+        if (levelPath.empty())
+        {
+            out = Level::empty(width, height);
+            return true;
+        }
+        return Level::load(levelPath, out, error);
+    }
+
+private:
+    static constexpr const char *kDirs = "UDLR";
+
+    // target as seen from the directory holding file; absolute when there
+    // is no relative route (another drive on Windows).
+    static std::string relativeTo(const std::string &target, const std::string &file)
+    {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        fs::path from = fs::absolute(fs::path(file), ec).parent_path();
+        fs::path to = fs::absolute(fs::path(target), ec).lexically_normal();
+        fs::path rel = to.lexically_relative(from);
+        return ec || rel.empty() ? to.string() : rel.generic_string();
+    }
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Engine.h"
+#include "Terminal.h"
+
+// Builds the character grid of a frame from engine state. Shared by the
+// terminal game and headless replay playback.
+class Scene
+{
+public:
+    explicit Scene(const Level &level) : background_(bakeBackground(level)), frame_(background_) {}
+
+    // Brings the frame up to date with engine and returns it. The frame
+    // persists between calls: after a single step only the new head, the
+    // neck, the new tail, the cells the tail left and the cells where items
+    // came or went are redrawn. Anything else (a reset, several steps at once) redraws it all.
+    // best < 0 leaves the high score out of the HUD. progress is how far the
+    // current tick has run (0..1); from halfway on, the head reaches half into
+    // the cell it will enter and the tail half leaves its cell, so motion has
+    // twice the resolution of the simulation.
+    const std::vector<std::string> &build(const Engine &engine, int best = -1, double progress = 0.0)
+    {
+        lift();
+        bool same = valid_ && engine.gameId() == gameId_ && engine.gameOver() == over_;
+        if (!(same && engine.tick() == tick_))
+        {
+            if (same && engine.tick() == tick_ + 1)
+            {
+                advance(engine);
+            }
+            else if (valid_ && engine.gameId() == gameId_ && engine.gameOver() && !over_ &&
+                     engine.tick() == tick_ + 1)
+            {
+                // The fatal step leaves the body where it was.
+                gameOver(engine);
+            }
+            else
+            {
+                redraw(engine);
+            }
+            remember(engine);
+        }
+        if (progress >= 0.5 && !engine.gameOver())
+        {
+            halfStep(engine);
+        }
+        updateHud(engine.score(), best < 0 ? -1 : std::max(best, engine.score()));
+        return frame_;
+    }
+
+private:
+    std::vector<std::string> background_;
+    std::vector<std::string> frame_;
+    bool valid_{false};
+    uint32_t gameId_{};
+    uint64_t tick_{};
+    bool over_{false};
+    size_t length_{};
+    // The last two body cells as last drawn, so the cells a step trims can
+    // be given back to the background.
+    std::array<int, 2> tail_{};
+    int hudScore_{-1};
+    int hudBest_{-1};
+    bool hudValid_{false};
+    // Cells a half step drew over, with what they showed before.
+    std::array<std::pair<Vec2, char>, 2> lifted_{};
+    size_t liftedCount_{0};
+
+    void remember(const Engine &engine)
+    {
+        const Body &snake = engine.snake();
+        valid_ = true;
+        gameId_ = engine.gameId();
+        tick_ = engine.tick();
+        over_ = engine.gameOver();
+        length_ = snake.size();
+        tail_ = {snake[snake.size() - 1], snake[snake.size() - 2]};
+    }
+
+    void redraw(const Engine &engine)
+    {
+        frame_ = background_;
+        hudValid_ = false;
+        drawItems(engine);
+        const Body &snake = engine.snake();
+        for (size_t i = snake.size(); i-- > 0;)
+        {
+            put(engine.pos(snake[i]), segmentGlyph(engine, i));
+        }
+        if (engine.gameOver())
+        {
+            gameOver(engine);
+        }
+    }
+
+    // One step since the last frame: the body gained a head and lost 0, 1 or
+    // 2 tail segments.
+    void advance(const Engine &engine)
+    {
+        const Body &snake = engine.snake();
+        size_t trimmed = length_ + 1 - snake.size();
+        for (size_t k = 0; k < trimmed && k < tail_.size(); k++)
+        {
+            // While ghosting another segment may still cover the cell.
+            if (engine.open(tail_[k]))
+            {
+                Vec2 p = engine.pos(tail_[k]);
+                frame_[p.y][p.x] = background_[p.y][p.x];
+            }
+        }
+        if (!engine.itemChangesKnown())
+        {
+            drawItems(engine);
+        }
+        for (size_t k = 0; k < engine.itemChangeCount(); k++)
+        {
+            // A taken item's cell is under the head, drawn below.
+            int cell = engine.itemChange(k);
+            if (const Pickup *p = engine.itemAt(cell))
+            {
+                put(p->pos, itemGlyph(p->item));
+            }
+        }
+        // A full redraw lets the segment nearest the head win a shared cell.
+        if (engine.segmentsAt(snake.back()) == 1)
+        {
+            put(engine.pos(snake.back()), segmentGlyph(engine, snake.size() - 1));
+        }
+        put(engine.pos(snake[1]), segmentGlyph(engine, 1));
+        put(engine.pos(snake.front()), segmentGlyph(engine, 0));
+    }
+
+    void gameOver(const Engine &engine)
+    {
+        int w = engine.width();
+        std::string msg = "GAME OVER  (R=restart, Q=quit)";
+        int start = std::max(1, (w - static_cast<int>(msg.size())) / 2);
+        int y = engine.height() / 2;
+        for (size_t i = 0; i < msg.size() && start + static_cast<int>(i) < w - 1; i++)
+        {
+            frame_[y][start + static_cast<int>(i)] = msg[i];
+        }
+    }
+
+    // Items only appear on free cells and leave under the head, so drawing
+    // them over the frame is enough.
+    void drawItems(const Engine &engine)
+    {
+        for (const Pickup &p : engine.items())
+        {
+            put(p.pos, itemGlyph(p.item));
+        }
+    }
+
+    void put(const Vec2 &p, char glyph) { frame_[p.y][p.x] = glyph; }
+
+    void lift()
+    {
+        while (liftedCount_ > 0)
+        {
+            liftedCount_--;
+            put(lifted_[liftedCount_].first, lifted_[liftedCount_].second);
+        }
+    }
+
+    void overlay(const Vec2 &p, char glyph)
+    {
+        lifted_[liftedCount_++] = {p, frame_[p.y][p.x]};
+        put(p, glyph);
+    }
+
+    // Only between cells that touch on screen; wrap and portal moves jump.
+    void halfStep(const Engine &engine)
+    {
+        const Body &snake = engine.snake();
+        Vec2 head = engine.pos(snake.front());
+        int next = 0;
+        Dir d = engine.dir();
+        Vec2 to = engine.pos(engine.neighbor(snake.front(), d));
+        if (engine.probe(d, next) && to.x == head.x + delta(d).x && to.y == head.y + delta(d).y)
+        {
+            // The head enters through the side facing it.
+            overlay(to, static_cast<char>(kHalfUp + static_cast<int>(opposite(d))));
+        }
+        if (engine.pendingGrowth() > 0 || engine.segmentsAt(snake.back()) > 1)
+        {
+            return;
+        }
+        Vec2 tail = engine.pos(snake.back());
+        Vec2 after = engine.pos(snake[snake.size() - 2]);
+        for (int k = 0; k < 4; k++)
+        {
+            if (after.x == tail.x + kDirDelta[k].x && after.y == tail.y + kDirDelta[k].y)
+            {
+                // The tail keeps the half facing the rest of the body.
+                overlay(tail, static_cast<char>(kHalfUp + k));
+            }
+        }
+    }
+
+    // Head, or a box-drawing piece joining segment i to its neighbours in the
+    // body; the tail is a straight piece pointing at the segment before it.
+    static char segmentGlyph(const Engine &engine, size_t i)
+    {
+        if (i == 0)
+        {
+            return static_cast<char>(kGlyphHead);
+        }
+        const Body &snake = engine.snake();
+        int links = link(engine, snake[i], snake[i - 1]);
+        if (i + 1 < snake.size())
+        {
+            links |= link(engine, snake[i], snake[i + 1]);
+        }
+        return static_cast<char>(kBodyGlyphs[links]);
+    }
+
+    // Bit of the direction leading from cell a to cell b (through wrap or a
+    // portal if need be), 0 when they are not neighbours.
+    static int link(const Engine &engine, int a, int b)
+    {
+        for (int d = 0; d < 4; d++)
+        {
+            if (engine.neighbor(a, static_cast<Dir>(d)) == b)
+            {
+                return 1 << d;
+            }
+        }
+        return 0;
+    }
+
+    void updateHud(int score, int best)
+    {
+        if (hudValid_ && score == hudScore_ && best == hudBest_)
+        {
+            return;
+        }
+        hudValid_ = true;
+        hudScore_ = score;
+        hudBest_ = best;
+
+        // Both numbers fit in 11 characters each; the labels take 35.
+        char text[96];
+        char *p = text;
+        auto put = [&p](const char *s) {
+            size_t n = std::strlen(s);
+            std::memcpy(p, s, n);
+            p += n;
+        };
+        put("Score: ");
+        p = std::to_chars(p, p + 11, score).ptr;
+        if (best >= 0)
+        {
+            put("  Best: ");
+            p = std::to_chars(p, p + 11, best).ptr;
+        }
+        put("   WASD=move  Q=quit");
+
+        // A shorter HUD than last time gives the leftover cells back to the
+        // background.
+        std::string &row = frame_[0];
+        size_t len = static_cast<size_t>(p - text);
+        for (size_t i = 0; i + 2 < row.size(); i++)
+        {
+            row[i + 2] = i < len ? text[i] : background_[0][i + 2];
+        }
+    }
+
+    // Terrain never changes during a game, so it is drawn once and every frame
+    // starts from a copy.
+    static std::vector<std::string> bakeBackground(const Level &level)
+    {
+        std::vector<std::string> buf(level.h, std::string(level.w, ' '));
+        for (int y = 0; y < level.h; y++)
+        {
+            for (int x = 0; x < level.w; x++)
+            {
+                uint8_t cell = level.at({x, y});
+                if (cell == Level::kWall)
+                {
+                    buf[y][x] = static_cast<char>(kGlyphWall);
+                }
+                else if (cell >= Level::kPortalBase)
+                {
+                    buf[y][x] = level.portalGlyphs[cell - Level::kPortalBase];
+                }
+            }
+        }
+        return buf;
+    }
+
+    static char itemGlyph(Item item)
+    {
+        switch (item)
+        {
+        case Item::Food:
+            return static_cast<char>(kGlyphFood);
+        case Item::SlowDown:
+            return static_cast<char>(kGlyphSlowDown);
+        case Item::SpeedUp:
+            return static_cast<char>(kGlyphSpeedUp);
+        case Item::Shrink:
+            return static_cast<char>(kGlyphShrink);
+        case Item::Ghost:
+            return static_cast<char>(kGlyphGhost);
+        }
+        return '?';
+    }
+};
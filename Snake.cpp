@@ -1,430 +1,580 @@
-#include <chrono>
-#include <deque>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
-#include <random>
+#include <limits>
+#include <memory>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
 
-#ifdef _WIN32
-#include <conio.h>
-#include <windows.h>
-#else
-#include <sys/select.h>
-#include <termios.h>
-#include <unistd.h>
-#endif
+#include "Agents.h"
+#include "Engine.h"
+#include "Game.h"
+#include "Leaderboard.h"
+#include "Modes.h"
 
-struct Vec2
+// Everything main can be told on the command line.
+struct Options
 {
-    int x{};
-    int y{};
-    bool operator==(const Vec2 &other) const { return x == other.x && y == other.y; }
+    std::string levelPath;
+    int width{50};
+    int height{22};
+    bool sized{false};
+    Rules rules;
+    GameConfig game;
+    uint64_t seed{0};
+    bool seeded{false};
+    std::string agent;
+    std::string genome;
+    std::string weights;
+    std::string initWeights;
+    std::string record;
+    std::vector<std::string> replays;
+    std::string scores{"snake.scores"};
+    std::string player;
+    int top{0};
+    bool headless{false};
+    int games{1};
+    // Agents can circle forever without dying, so headless games are capped.
+    uint64_t maxTicks{100000};
+    bool bench{false};
+    std::string benchOnly;
+    bool train{false};
+    train::Config trainConfig;
+    int stats{0};
+    std::string statsOut;
+    bool help{false};
 };
 
-enum class Dir
+const char *kUsage = R"(usage: snake [options] [level-file]
+
+board and rules
+  --size WxH            board size without a level file (default 50x22)
+  --wrap                leave through one edge, come back through the other
+  --food N              food items on the board (default 1)
+  --grow N              segments gained per food (default 1)
+  --seed N              fixed seed instead of a random one
+
+timing and output
+  --tick MS             starting tick length (default 110)
+  --min-tick MS         shortest tick (default 55)
+  --speedup MS          tick shortening per food (default 2)
+  --render MODE         diff, full or none (default diff)
+  --theme NAME          ascii, box or color (default box)
+  --smooth              move head and tail by half cells between ticks
+  --no-focus-pause      keep playing while the terminal is unfocused
+
+autopilot
+  --agent NAME          mcts, heuristic, mlp or random
+  --genome FILE         heuristic weights
+  --weights FILE        mlp weights
+  --init-weights FILE   write random mlp weights and exit
+
+modes
+  --headless            play the agent without a terminal and print results
+  --games N             games to play headless (default 1)
+  --ticks N             stop headless games after N ticks, 0 = never (default 100000)
+  --record FILE         save the game as a replay
+  --scores FILE         high-score log (default snake.scores, "none" to keep no scores)
+  --name NAME           player name for the high scores (default: $USER)
+  --top N               print the N best scores and exit
+  --replay FILE...      play replays back without a terminal
+  --stats N             play N headless games on all cores and print score, length,
+                        survival and cause-of-death distributions (default agent: random)
+  --stats-out FILE      stream one row per game to FILE (.csv, otherwise binary)
+  --train N             evolve heuristic weights for N generations
+  --out FILE            where --train writes the best genome (default best.genome)
+  --bench [GROUP]       run benchmarks
+  --help                this text
+)";
+
+// Parses a whole decimal number in [lo, hi].
+bool parseNumber(const char *text, long long lo, long long hi, long long &out)
 {
-    Up,
-    Down,
-    Left,
-    Right
-};
-
-class Random
-{
-public:
-    Random() : rng_(std::random_device{}()) {}
-    int nextInt(int lo, int hi)
+    char *end = nullptr;
+    errno = 0;
+    long long v = std::strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || v < lo || v > hi)
     {
-        std::uniform_int_distribution<int> dist(lo, hi);
-        return dist(rng_);
+        return false;
     }
+    out = v;
+    return true;
+}
 
-private:
-    std::mt19937 rng_;
-};
-
-#ifdef _WIN32
-class Input
+bool parseOptions(int argc, char **argv, Options &o, std::string &error)
 {
-public:
-    Input() { enableAnsi(); }
-    char pollKey()
+    for (int i = 1; i < argc; i++)
     {
-        char ch = 0;
-        if (_kbhit())
+        std::string arg = argv[i];
+        // Value of an option that takes one, checked to be a number in range.
+        auto value = [&](long long lo, long long hi, long long &out) {
+            if (i + 1 >= argc)
+            {
+                error = arg + " needs a value";
+                return false;
+            }
+            if (!parseNumber(argv[++i], lo, hi, out))
+            {
+                error = arg + " expects a number from " + std::to_string(lo) + " to " + std::to_string(hi) +
+                        ", got '" + argv[i] + "'";
+                return false;
+            }
+            return true;
+        };
+        auto text = [&](std::string &out) {
+            if (i + 1 >= argc)
+            {
+                error = arg + " needs a value";
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+        long long n = 0;
+        bool ok = true;
+        if (arg == "--help" || arg == "-h")
+        {
+            o.help = true;
+        }
+        else if (arg == "--size")
         {
-            ch = static_cast<char>(_getch());
-            if (ch == 0 || ch == static_cast<char>(224))
+            std::string size;
+            size_t x = 0;
+            long long w = 0;
+            long long h = 0;
+            ok = text(size);
+            if (ok)
             {
-                // swallow extended code
-                if (_kbhit())
+                x = size.find('x');
+                ok = x != std::string::npos && parseNumber(size.substr(0, x).c_str(), 8, 4096, w) &&
+                     parseNumber(size.substr(x + 1).c_str(), 6, 4096, h);
+                if (!ok)
                 {
-                    (void)_getch();
+                    error = "--size expects WxH with W from 8 to 4096 and H from 6 to 4096, got '" + size + "'";
                 }
-                ch = 0;
             }
+            o.width = static_cast<int>(w);
+            o.height = static_cast<int>(h);
+            o.sized = true;
         }
-        return ch;
-    }
-
-private:
-    void enableAnsi()
-    {
-        HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-        if (hOut != INVALID_HANDLE_VALUE)
+        else if (arg == "--wrap")
         {
-            DWORD mode = 0;
-            if (GetConsoleMode(hOut, &mode))
-            {
-                mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-                (void)SetConsoleMode(hOut, mode);
-            }
+            o.rules.wrap = true;
         }
-    }
-};
-#else
-class Input
-{
-public:
-    Input() { enableRawMode(); }
-    ~Input() { restoreMode(); }
-
-    char pollKey()
-    {
-        char ch = 0;
-        if (stdinReady())
+        else if (arg == "--food")
+        {
+            ok = value(1, 100000, n);
+            o.rules.foodCount = static_cast<int>(n);
+        }
+        else if (arg == "--grow")
         {
-            ssize_t n = ::read(STDIN_FILENO, &ch, 1);
-            if (n <= 0)
+            ok = value(0, 1000, n);
+            o.rules.growthPerFood = static_cast<int>(n);
+        }
+        else if (arg == "--seed")
+        {
+            // Any 64-bit value, so every seed the leaderboard shows can be replayed.
+            std::string seed;
+            ok = text(seed);
+            if (ok)
             {
-                ch = 0;
+                const char *end = seed.data() + seed.size();
+                std::from_chars_result r = std::from_chars(seed.data(), end, o.seed);
+                ok = !seed.empty() && r.ec == std::errc() && r.ptr == end;
+                if (!ok)
+                {
+                    error = "--seed expects a number from 0 to " +
+                            std::to_string(std::numeric_limits<uint64_t>::max()) + ", got '" + seed + "'";
+                }
             }
+            o.seeded = true;
         }
-        return ch;
-    }
-
-private:
-    termios orig_{};
-    bool hasOrig_{false};
-
-    void enableRawMode()
-    {
-        termios t{};
-        if (tcgetattr(STDIN_FILENO, &t) == 0)
+        else if (arg == "--tick")
         {
-            orig_ = t;
-            hasOrig_ = true;
-            t.c_lflag &= static_cast<unsigned>(~(ICANON | ECHO));
-            t.c_cc[VMIN] = 0;
-            t.c_cc[VTIME] = 0;
-            (void)tcsetattr(STDIN_FILENO, TCSANOW, &t);
+            ok = value(1, 10000, n);
+            o.game.tickMs = static_cast<int>(n);
         }
-    }
-    void restoreMode()
-    {
-        if (hasOrig_)
+        else if (arg == "--min-tick")
         {
-            (void)tcsetattr(STDIN_FILENO, TCSANOW, &orig_);
+            ok = value(1, 10000, n);
+            o.game.minTickMs = static_cast<int>(n);
         }
-    }
-    bool stdinReady()
-    {
-        fd_set set;
-        FD_ZERO(&set);
-        FD_SET(STDIN_FILENO, &set);
-        timeval tv{};
-        tv.tv_sec = 0;
-        tv.tv_usec = 0;
-        int r = select(STDIN_FILENO + 1, &set, nullptr, nullptr, &tv);
-        return r > 0 && FD_ISSET(STDIN_FILENO, &set);
-    }
-};
-#endif
-
-class Renderer
-{
-public:
-    Renderer(int w, int h) : w_(w), h_(h) {}
-    void clearScreen() const
-    {
-        std::cout << "\x1b[2J\x1b[H";
-    }
-    void draw(const std::vector<std::string> &buf) const
-    {
-        clearScreen();
-        for (const auto &line : buf)
+        else if (arg == "--speedup")
         {
-            std::cout << line << "\n";
+            ok = value(0, 10000, n);
+            o.game.speedupMs = static_cast<int>(n);
         }
-        std::cout.flush();
-    }
-
-private:
-    int w_{};
-    int h_{};
-};
-
-class Game
-{
-public:
-    Game(int w, int h)
-        : w_(w), h_(h), rnd_(), input_(), render_(w, h)
-    {
-        reset();
-    }
-
-    int run()
-    {
-        using clock = std::chrono::steady_clock;
-        auto last = clock::now();
-
-        while (!quit_)
+        else if (arg == "--render")
         {
-            handleInput();
-            auto now = clock::now();
-            auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(now - last);
-            if (dt.count() >= tickMs_)
+            std::string mode;
+            ok = text(mode);
+            if (mode == "diff")
+            {
+                o.game.render = RenderMode::Diff;
+            }
+            else if (mode == "full")
             {
-                step();
-                last = now;
+                o.game.render = RenderMode::Full;
+            }
+            else if (mode == "none")
+            {
+                o.game.render = RenderMode::None;
+            }
+            else if (ok)
+            {
+                error = "--render expects diff, full or none, got '" + mode + "'";
+                ok = false;
             }
-            drawFrame();
-            std::this_thread::sleep_for(std::chrono::milliseconds(8));
         }
-        return 0;
-    }
-
-private:
-    int w_{};
-    int h_{};
-    Random rnd_;
-    Input input_;
-    Renderer render_;
-
-    std::deque<Vec2> snake_;
-    Vec2 food_{};
-    Dir dir_{Dir::Right};
-    bool quit_{false};
-    bool gameOver_{false};
-    int score_{0};
-    int tickMs_{110};
-
-    void reset()
-    {
-        snake_.clear();
-        snake_.push_back({w_ / 2, h_ / 2});
-        snake_.push_back({w_ / 2 - 1, h_ / 2});
-        snake_.push_back({w_ / 2 - 2, h_ / 2});
-        dir_ = Dir::Right;
-        quit_ = false;
-        gameOver_ = false;
-        score_ = 0;
-        tickMs_ = 110;
-        spawnFood();
-    }
-
-    void handleInput()
-    {
-        char c = input_.pollKey();
-        if (c == 0)
+        else if (arg == "--smooth")
         {
-            return;
+            o.game.smooth = true;
         }
-
-        if (c == 'q' || c == 'Q')
+        else if (arg == "--no-focus-pause")
         {
-            quit_ = true;
-            return;
+            o.game.focusPause = false;
         }
-        if ((c == 'r' || c == 'R') && gameOver_)
+        else if (arg == "--theme")
         {
-            reset();
-            return;
-        }
-
-        Dir next = dir_;
-        if (c == 'w' || c == 'W')
-        {
-            next = Dir::Up;
+            std::string name;
+            ok = text(name);
+            if (name == "ascii")
+            {
+                o.game.theme = ThemeStyle::Ascii;
+            }
+            else if (name == "box")
+            {
+                o.game.theme = ThemeStyle::Box;
+            }
+            else if (name == "color")
+            {
+                o.game.theme = ThemeStyle::Color;
+            }
+            else if (ok)
+            {
+                error = "--theme expects ascii, box or color, got '" + name + "'";
+                ok = false;
+            }
         }
-        if (c == 's' || c == 'S')
+        else if (arg == "--agent")
         {
-            next = Dir::Down;
+            ok = text(o.agent);
         }
-        if (c == 'a' || c == 'A')
+        else if (arg == "--genome")
         {
-            next = Dir::Left;
+            ok = text(o.genome);
         }
-        if (c == 'd' || c == 'D')
+        else if (arg == "--weights")
         {
-            next = Dir::Right;
+            ok = text(o.weights);
         }
-
-        if (!isOpposite(dir_, next))
+        else if (arg == "--init-weights")
         {
-            dir_ = next;
+            ok = text(o.initWeights);
         }
-    }
-
-    void step()
-    {
-        if (gameOver_)
+        else if (arg == "--headless")
         {
-            return;
+            o.headless = true;
         }
-
-        Vec2 head = snake_.front();
-        Vec2 next = head;
-
-        if (dir_ == Dir::Up)
+        else if (arg == "--games")
         {
-            next.y -= 1;
+            ok = value(1, 1000000, n);
+            o.games = static_cast<int>(n);
         }
-        if (dir_ == Dir::Down)
+        else if (arg == "--ticks")
         {
-            next.y += 1;
+            ok = value(0, std::numeric_limits<long long>::max(), n);
+            o.maxTicks = static_cast<uint64_t>(n);
         }
-        if (dir_ == Dir::Left)
+        else if (arg == "--record")
         {
-            next.x -= 1;
+            ok = text(o.record);
         }
-        if (dir_ == Dir::Right)
+        else if (arg == "--scores")
         {
-            next.x += 1;
+            ok = text(o.scores);
         }
-
-        if (hitWall(next) || hitSelf(next))
+        else if (arg == "--name")
         {
-            gameOver_ = true;
-            return;
+            ok = text(o.player);
         }
-
-        snake_.push_front(next);
-
-        if (next == food_)
+        else if (arg == "--top")
         {
-            score_ += 10;
-            tickMs_ = std::max(55, tickMs_ - 2);
-            spawnFood();
-            return;
+            ok = value(1, 1000000, n);
+            o.top = static_cast<int>(n);
         }
-
-        snake_.pop_back();
-    }
-
-    bool hitWall(const Vec2 &p) const
-    {
-        return p.x <= 0 || p.x >= w_ - 1 || p.y <= 0 || p.y >= h_ - 1;
-    }
-
-    bool hitSelf(const Vec2 &p) const
-    {
-        for (size_t i = 0; i < snake_.size(); i++)
+        else if (arg == "--replay")
         {
-            if (snake_[i] == p)
+            while (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                o.replays.push_back(argv[++i]);
+            }
+            if (o.replays.empty())
             {
-                return true;
+                error = "--replay needs at least one file";
+                ok = false;
             }
         }
-        return false;
-    }
-
-    bool isOpposite(Dir a, Dir b) const
-    {
-        if (a == Dir::Up && b == Dir::Down)
+        else if (arg == "--stats")
         {
-            return true;
+            ok = value(1, std::numeric_limits<int>::max(), n);
+            o.stats = static_cast<int>(n);
         }
-        if (a == Dir::Down && b == Dir::Up)
+        else if (arg == "--stats-out")
         {
-            return true;
+            ok = text(o.statsOut);
         }
-        if (a == Dir::Left && b == Dir::Right)
+        else if (arg == "--train")
         {
-            return true;
+            ok = value(1, 1000000, n);
+            o.train = true;
+            o.trainConfig.generations = static_cast<int>(n);
         }
-        if (a == Dir::Right && b == Dir::Left)
+        else if (arg == "--out")
         {
-            return true;
+            ok = text(o.trainConfig.out);
         }
-        return false;
-    }
-
-    void spawnFood()
-    {
-        Vec2 p{};
-        bool ok = false;
-
-        while (!ok)
+        else if (arg == "--bench")
         {
-            p.x = rnd_.nextInt(1, w_ - 2);
-            p.y = rnd_.nextInt(1, h_ - 2);
-            ok = true;
-
-            for (size_t i = 0; i < snake_.size(); i++)
+            o.bench = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
             {
-                if (snake_[i] == p)
+                o.benchOnly = argv[++i];
+                const std::vector<std::string> &groups = bench::groups();
+                if (std::find(groups.begin(), groups.end(), o.benchOnly) == groups.end())
                 {
+                    error = "unknown benchmark group '" + o.benchOnly + "', expected one of:";
+                    for (const std::string &g : groups)
+                    {
+                        error += " " + g;
+                    }
                     ok = false;
                 }
             }
         }
-
-        food_ = p;
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            error = "unknown option " + arg + " (see --help)";
+            ok = false;
+        }
+        else if (o.levelPath.empty())
+        {
+            o.levelPath = arg;
+        }
+        else
+        {
+            error = "more than one level file: " + o.levelPath + ", " + arg;
+            ok = false;
+        }
+        if (!ok)
+        {
+            return false;
+        }
     }
-
-    std::vector<std::string> buildBuffer() const
+    if (o.sized && !o.levelPath.empty())
     {
-        std::vector<std::string> buf(h_, std::string(w_, ' '));
+        error = "--size cannot be combined with a level file";
+        return false;
+    }
+    if (o.game.minTickMs > o.game.tickMs)
+    {
+        error = "--min-tick is longer than --tick";
+        return false;
+    }
+    if (o.headless && o.agent.empty())
+    {
+        error = "--headless needs an --agent";
+        return false;
+    }
+    if (o.agent == "mlp" && o.weights.empty())
+    {
+        error = "--agent mlp requires --weights FILE";
+        return false;
+    }
+    // The benchmarks fix their own boards, seeds and rules so runs compare.
+    Rules defaults;
+    if (o.bench && (o.sized || o.seeded || !o.levelPath.empty() || o.rules.wrap != defaults.wrap ||
+                    o.rules.foodCount != defaults.foodCount || o.rules.growthPerFood != defaults.growthPerFood))
+    {
+        error = "--bench cannot be combined with --size, --wrap, --food, --grow, --seed or a level file";
+        return false;
+    }
+    return true;
+}
 
-        for (int x = 0; x < w_; x++)
+// mctsThreads > 0 overrides the search's thread count.
+std::unique_ptr<Agent> makeAgent(const Options &o, std::string &error, unsigned mctsThreads = 0)
+{
+    if (o.agent == "random")
+    {
+        return std::make_unique<RandomAgent>();
+    }
+    if (o.agent == "mcts")
+    {
+        MctsConfig config;
+        if (mctsThreads > 0)
         {
-            buf[0][x] = '#';
-            buf[h_ - 1][x] = '#';
+            config.threads = mctsThreads;
         }
-        for (int y = 0; y < h_; y++)
+        return std::make_unique<MctsAgent>(config);
+    }
+    if (o.agent == "heuristic")
+    {
+        Genome genome;
+        if (!o.genome.empty() && !genome.load(o.genome))
         {
-            buf[y][0] = '#';
-            buf[y][w_ - 1] = '#';
+            error = "cannot read genome: " + o.genome;
+            return nullptr;
         }
-
-        buf[food_.y][food_.x] = '*';
-
-        for (size_t i = 0; i < snake_.size(); i++)
+        return std::make_unique<HeuristicAgent>(genome);
+    }
+    if (o.agent == "mlp")
+    {
+        MlpPolicy policy;
+        if (!policy.load(o.weights, error))
         {
-            const Vec2 &p = snake_[i];
-            buf[p.y][p.x] = (i == 0) ? 'O' : 'o';
+            return nullptr;
         }
+        return std::make_unique<MlpAgent>(std::move(policy));
+    }
+    error = "unknown agent: " + o.agent;
+    return nullptr;
+}
 
-        std::string hud = "Score: " + std::to_string(score_) + "   WASD=move  Q=quit";
-        for (size_t i = 0; i < hud.size() && i + 2 < static_cast<size_t>(w_); i++)
+int main(int argc, char **argv)
+{
+    Options opt;
+    std::string error;
+    if (!parseOptions(argc, argv, opt, error))
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    if (opt.help)
+    {
+        std::cout << kUsage;
+        return 0;
+    }
+    if (opt.bench)
+    {
+        return bench::run(opt.benchOnly);
+    }
+    if (!opt.replays.empty())
+    {
+        return replay::run(opt.replays);
+    }
+    Leaderboard scores;
+    if (opt.top > 0)
+    {
+        if (opt.scores == "none")
         {
-            buf[0][i + 2] = hud[i];
+            std::cerr << "--top: the high-score table is disabled by --scores none\n";
+            return 1;
         }
-
-        if (gameOver_)
+        if (!scores.open(opt.scores, error))
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        int rank = 1;
+        for (const ScoreEntry &e : scores.top(static_cast<size_t>(opt.top)))
         {
-            std::string msg = "GAME OVER  (R=restart, Q=quit)";
-            int start = std::max(1, (w_ - static_cast<int>(msg.size())) / 2);
-            int y = h_ / 2;
-            for (size_t i = 0; i < msg.size() && start + static_cast<int>(i) < w_ - 1; i++)
+            char date[32] = "";
+            std::time_t t = static_cast<std::time_t>(e.time);
+            if (const std::tm *tm = std::localtime(&t))
             {
-                buf[y][start + static_cast<int>(i)] = msg[i];
+                std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M", tm);
             }
+            std::cout << std::setw(4) << rank++ << ".  " << std::setw(6) << e.score << "  " << std::left
+                      << std::setw(16) << e.player() << std::right << "  " << date << "  seed " << e.seed << "\n";
         }
-
-        return buf;
+        return 0;
     }
-
-    void drawFrame() const
+    if (!opt.initWeights.empty())
     {
-        render_.draw(buildBuffer());
+        MlpPolicy policy;
+        policy.randomize(32, opt.seeded ? opt.seed : randomSeed());
+        if (!policy.save(opt.initWeights))
+        {
+            std::cerr << "cannot write " << opt.initWeights << "\n";
+            return 1;
+        }
+        return 0;
     }
-};
 
-int main()
-{
-    Game game(50, 22);
+    Level level = Level::empty(opt.width, opt.height);
+    if (!opt.levelPath.empty() && !Level::load(opt.levelPath, level, error))
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    if (opt.train)
+    {
+        return train::run(level, opt.rules, opt.trainConfig);
+    }
+    if (opt.stats > 0)
+    {
+        stats::Config config;
+        config.games = opt.stats;
+        config.seed = opt.seeded ? opt.seed : randomSeed();
+        config.maxTicks = opt.maxTicks;
+        config.out = opt.statsOut;
+        Options agentOpt = opt;
+        if (agentOpt.agent.empty())
+        {
+            agentOpt.agent = "random";
+        }
+        // Games already run one per core, so each search gets a single thread.
+        return stats::run(level, opt.rules, config, [&] {
+            std::unique_ptr<Agent> agent = makeAgent(agentOpt, error, 1);
+            if (!agent)
+            {
+                std::cerr << error << "\n";
+            }
+            return agent;
+        });
+    }
+    std::unique_ptr<Agent> agent;
+    if (!opt.agent.empty())
+    {
+        agent = makeAgent(opt, error);
+        if (!agent)
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+    }
+    uint64_t seed = opt.seeded ? opt.seed : randomSeed();
+    if (opt.headless)
+    {
+        return headless::run(level, opt.levelPath, opt.rules, seed, *agent, opt.games, opt.maxTicks, opt.record);
+    }
+    Game game(level, opt.rules, opt.game, seed, std::move(agent));
+    if (!opt.record.empty())
+    {
+        game.recordTo(opt.record, opt.levelPath);
+    }
+    if (opt.scores != "none")
+    {
+        if (!scores.open(opt.scores, error))
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        std::string player = opt.player;
+        if (player.empty())
+        {
+            const char *user = std::getenv("USER");
+            user = user != nullptr ? user : std::getenv("USERNAME");
+            player = user != nullptr ? user : "player";
+        }
+        game.keepScores(scores, player);
+    }
     return game.run();
 }
@@ -0,0 +1,461 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+#else
+#include <csignal>
+#include <sys/select.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+class Input
+{
+public:
+    Input() { enableAnsi(); }
+    char pollKey()
+    {
+        char ch = 0;
+        if (_kbhit())
+        {
+            ch = static_cast<char>(_getch());
+            if (ch == 0 || ch == static_cast<char>(224))
+            {
+                // swallow extended code
+                if (_kbhit())
+                {
+                    (void)_getch();
+                }
+                ch = 0;
+            }
+        }
+        return ch;
+    }
+
+    // Focus reports are not read from the Windows console, so the game never
+    // pauses on its own there.
+    bool focused() const { return true; }
+    void wait() {}
+
+private:
+    void enableAnsi()
+    {
+        HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+        if (hOut != INVALID_HANDLE_VALUE)
+        {
+            DWORD mode = 0;
+            if (GetConsoleMode(hOut, &mode))
+            {
+                mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+                (void)SetConsoleMode(hOut, mode);
+            }
+        }
+        // Themes draw with UTF-8 box-drawing characters.
+        (void)SetConsoleOutputCP(CP_UTF8);
+    }
+};
+#else
+class Input
+{
+public:
+    Input() { enableRawMode(); }
+    ~Input() { restoreMode(); }
+
+    // Next key, 0 when there is none. Escape sequences never come out as
+    // keys: focus reports (CSI I / CSI O) update focused(), anything else
+    // (CSI or SS3 arrow keys and the like) is dropped so its letters don't
+    // read as WASD.
+    char pollKey()
+    {
+        char ch = 0;
+        while (next(ch, 0))
+        {
+            if (ch != '\x1b')
+            {
+                return ch;
+            }
+            // SS3 (ESC O x, arrow keys in application cursor mode) ends with
+            // the byte after the O; any other pair but CSI is dropped whole.
+            char c = 0;
+            if (!next(c, kSequenceMs) || c != '[')
+            {
+                if (c == 'O')
+                {
+                    (void)next(c, kSequenceMs);
+                }
+                continue;
+            }
+            while (next(c, kSequenceMs) && (c < 0x40 || c > 0x7E))
+            {
+            }
+            if (c == 'I' || c == 'O')
+            {
+                focused_ = c == 'I';
+            }
+        }
+        return 0;
+    }
+
+    // False after the terminal reported losing focus; terminals that don't
+    // report focus stay focused.
+    bool focused() const { return focused_; }
+
+    // Sleeps until there is input, with no timeout. Bytes already read but
+    // not yet taken count as input.
+    void wait()
+    {
+        if (head_ == size_)
+        {
+            (void)stdinReady(-1);
+        }
+    }
+
+private:
+    // How long the rest of an escape sequence may trail its ESC.
+    static constexpr int kSequenceMs = 10;
+
+    // Signals that end the game without unwinding to the destructor.
+    static constexpr std::array<int, 3> kFatalSignals{SIGINT, SIGTERM, SIGHUP};
+
+    // Static so the signal handler can reach it; there is one terminal.
+    static inline termios orig_{};
+    bool hasOrig_{false};
+    std::array<void (*)(int), 3> prevHandlers_{};
+    bool focused_{true};
+    std::array<char, 64> buf_{};
+    size_t head_{0};
+    size_t size_{0};
+
+    bool next(char &ch, int waitMs)
+    {
+        if (head_ == size_)
+        {
+            if (!stdinReady(waitMs))
+            {
+                return false;
+            }
+            ssize_t n = ::read(STDIN_FILENO, buf_.data(), buf_.size());
+            if (n <= 0)
+            {
+                return false;
+            }
+            head_ = 0;
+            size_ = static_cast<size_t>(n);
+        }
+        ch = buf_[head_++];
+        return true;
+    }
+
+    void enableRawMode()
+    {
+        termios t{};
+        if (tcgetattr(STDIN_FILENO, &t) == 0)
+        {
+            orig_ = t;
+            hasOrig_ = true;
+            t.c_lflag &= static_cast<unsigned>(~(ICANON | ECHO));
+            t.c_cc[VMIN] = 0;
+            t.c_cc[VTIME] = 0;
+            (void)tcsetattr(STDIN_FILENO, TCSANOW, &t);
+            for (size_t i = 0; i < kFatalSignals.size(); i++)
+            {
+                // A signal the caller ignores (nohup) stays ignored.
+                prevHandlers_[i] = std::signal(kFatalSignals[i], onFatalSignal);
+                if (prevHandlers_[i] == SIG_IGN)
+                {
+                    (void)std::signal(kFatalSignals[i], SIG_IGN);
+                }
+            }
+            // Ask the terminal to report focus changes.
+            std::cout << "\x1b[?1004h" << std::flush;
+        }
+    }
+    void restoreMode()
+    {
+        if (hasOrig_)
+        {
+            std::cout << "\x1b[?1004l" << std::flush;
+            (void)tcsetattr(STDIN_FILENO, TCSANOW, &orig_);
+            for (size_t i = 0; i < kFatalSignals.size(); i++)
+            {
+                (void)std::signal(kFatalSignals[i], prevHandlers_[i] == SIG_ERR ? SIG_DFL : prevHandlers_[i]);
+            }
+        }
+    }
+    // Puts the terminal back as restoreMode() does, using only calls that
+    // are safe in a signal handler, then dies of the signal as it would have.
+    static void onFatalSignal(int sig)
+    {
+        static const char kRestore[] = "\x1b[0m\x1b[?1004l";
+        ssize_t written = ::write(STDOUT_FILENO, kRestore, sizeof(kRestore) - 1);
+        (void)written;
+        (void)tcsetattr(STDIN_FILENO, TCSANOW, &orig_);
+        (void)std::signal(sig, SIG_DFL);
+        (void)std::raise(sig);
+    }
+    // waitMs < 0 waits for as long as it takes.
+    bool stdinReady(int waitMs)
+    {
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(STDIN_FILENO, &set);
+        timeval tv{};
+        tv.tv_sec = waitMs / 1000;
+        tv.tv_usec = waitMs % 1000 * 1000;
+        int r = select(STDIN_FILENO + 1, &set, nullptr, nullptr, waitMs < 0 ? nullptr : &tv);
+        return r > 0 && FD_ISSET(STDIN_FILENO, &set);
+    }
+};
+#endif
+
+// Frame cells are one byte each: ASCII is text (HUD, messages, portal
+// letters) and stands for itself; codes from kGlyphBase up are game pieces,
+// which the Theme decides how to show.
+enum Glyph : uint8_t
+{
+    kGlyphBase = 0x80,
+    kBoxH = kGlyphBase, // body pieces: ─
+    kBoxV,              // │
+    kBoxDR,             // ┌
+    kBoxDL,             // ┐
+    kBoxUR,             // └
+    kBoxUL,             // ┘
+    kGlyphBody,         // segment with no clear shape (ghost overlaps)
+    kGlyphHead,
+    kGlyphWall,
+    kGlyphFood,
+    kGlyphSlowDown,
+    kGlyphSpeedUp,
+    kGlyphShrink,
+    kGlyphGhost,
+    kHalfUp,   // ▀ half cells of a head or tail between ticks, filled on the
+    kHalfDown, // ▄ side named (indexed like Dir)
+    kHalfLeft, // ▌
+    kHalfRight // ▐
+};
+
+// Body piece by the directions its neighbours lie in (bit Dir: 1 up, 2 down,
+// 4 left, 8 right). A single bit is the tail.
+constexpr std::array<uint8_t, 16> kBodyGlyphs{
+    kGlyphBody, kBoxV,  kBoxV,      kBoxV,      // -, U, D, UD
+    kBoxH,      kBoxUL, kBoxDL,     kGlyphBody, // L, UL, DL, UDL
+    kBoxH,      kBoxUR, kBoxDR,     kGlyphBody, // R, UR, DR, UDR
+    kBoxH,      kGlyphBody, kGlyphBody, kGlyphBody}; // LR, ULR, DLR, UDLR
+
+enum class ThemeStyle
+{
+    Ascii, // the classic # * O o
+    Box,   // box-drawing body
+    Color  // box-drawing body and SGR colours
+};
+
+// What every cell code turns into on the terminal, encoded once up front: an
+// SGR colour prefix followed by the UTF-8 glyph. The encoder only copies
+// bytes, leaving the prefix out when the terminal already has that colour.
+class Theme
+{
+public:
+    struct Entry
+    {
+        // Prefix (at most 8 bytes) then glyph (at most 4), zero padded so a
+        // fixed 16-byte copy from either start stays inside.
+        std::array<char, 24> bytes{};
+        uint8_t len{};
+        uint8_t glyph{}; // where the glyph starts
+        uint8_t color{}; // 0 = default attributes
+    };
+    static constexpr size_t kCopy = 16;
+
+    explicit Theme(ThemeStyle style = ThemeStyle::Box)
+    {
+        bool color = style == ThemeStyle::Color;
+        colored_ = color;
+        const char *reset = color ? "\x1b[0m" : "";
+        for (int c = 0; c < kGlyphBase; c++)
+        {
+            char text[2] = {static_cast<char>(c), 0};
+            set(static_cast<uint8_t>(c), text, 0, reset);
+        }
+        const char *green = color ? "\x1b[0;32m" : "";
+        if (style == ThemeStyle::Ascii)
+        {
+            for (int c = kBoxH; c <= kGlyphBody; c++)
+            {
+                set(static_cast<uint8_t>(c), "o", 0, "");
+            }
+            // No half cells in ASCII: a segment shows whole.
+            for (int c = kHalfUp; c <= kHalfRight; c++)
+            {
+                set(static_cast<uint8_t>(c), "o", 0, "");
+            }
+        }
+        else
+        {
+            const char *pieces[] = {"\xe2\x94\x80", "\xe2\x94\x82", "\xe2\x94\x8c", "\xe2\x94\x90",
+                                    "\xe2\x94\x94", "\xe2\x94\x98", "o"};
+            for (int c = kBoxH; c <= kGlyphBody; c++)
+            {
+                set(static_cast<uint8_t>(c), pieces[c - kBoxH], 1, green);
+            }
+            const char *halves[] = {"\xe2\x96\x80", "\xe2\x96\x84", "\xe2\x96\x8c", "\xe2\x96\x90"};
+            for (int c = kHalfUp; c <= kHalfRight; c++)
+            {
+                set(static_cast<uint8_t>(c), halves[c - kHalfUp], 1, green);
+            }
+        }
+        set(kGlyphHead, "O", 2, color ? "\x1b[0;92m" : "");
+        set(kGlyphWall, "#", 3, color ? "\x1b[0;34m" : "");
+        set(kGlyphFood, "*", 4, color ? "\x1b[0;91m" : "");
+        const char *yellow = color ? "\x1b[0;93m" : "";
+        set(kGlyphSlowDown, "-", 5, yellow);
+        set(kGlyphSpeedUp, "+", 5, yellow);
+        set(kGlyphShrink, "%", 5, yellow);
+        set(kGlyphGhost, "$", 5, yellow);
+    }
+
+    const Entry &operator[](uint8_t code) const { return entries_[code]; }
+
+    // Whether shown frames leave the terminal in a colour.
+    bool colored() const { return colored_; }
+
+private:
+    std::array<Entry, 256> entries_{};
+    bool colored_{false};
+
+    void set(uint8_t code, const char *glyph, uint8_t color, const char *sgr)
+    {
+        Entry &e = entries_[code];
+        size_t prefix = std::strlen(sgr);
+        size_t n = std::strlen(glyph);
+        std::memcpy(e.bytes.data(), sgr, prefix);
+        std::memcpy(e.bytes.data() + prefix, glyph, n);
+        e.len = static_cast<uint8_t>(prefix + n);
+        e.glyph = static_cast<uint8_t>(prefix);
+        e.color = colored_ ? color : 0;
+    }
+};
+
+class Renderer
+{
+public:
+    Renderer(int w, int h, const Theme &theme = Theme()) : w_(w), h_(h), theme_(theme) {}
+
+    ~Renderer()
+    {
+        if (drawn_ && theme_.colored())
+        {
+            std::cout << "\x1b[0m";
+            std::cout.flush();
+        }
+    }
+
+    void clearScreen() const
+    {
+        std::cout << "\x1b[2J\x1b[H";
+    }
+
+    void draw(const std::vector<std::string> &buf)
+    {
+        if (!encode(buf).empty())
+        {
+            drawn_ = true;
+            std::cout << out_;
+            std::cout.flush();
+        }
+    }
+
+    // Escape sequence turning the previous frame into buf: only the runs of
+    // cells that differ, each preceded by a cursor move. The first frame (or
+    // one after invalidate()) is drawn in full. Empty when nothing changed.
+    const std::string &encode(const std::vector<std::string> &buf)
+    {
+        out_.clear();
+        if (prev_.size() != buf.size())
+        {
+            out_ += "\x1b[2J";
+            prev_.assign(buf.size(), std::string());
+            color_ = kUnknownColor;
+        }
+        for (size_t y = 0; y < buf.size(); y++)
+        {
+            const std::string &line = buf[y];
+            std::string &old = prev_[y];
+            size_t x = 0;
+            while (x < line.size())
+            {
+                if (x < old.size() && old[x] == line[x])
+                {
+                    x++;
+                    continue;
+                }
+                size_t end = x + 1;
+                while (end < line.size() && (end >= old.size() || old[end] != line[end]))
+                {
+                    end++;
+                }
+                moveTo(y, x);
+                appendCells(line.data() + x, end - x);
+                x = end;
+            }
+            old = line;
+        }
+        if (!out_.empty())
+        {
+            moveTo(buf.size(), 0);
+        }
+        return out_;
+    }
+
+    void invalidate() { prev_.clear(); }
+
+private:
+    static constexpr uint8_t kUnknownColor = 0xFF;
+
+    int w_{};
+    int h_{};
+    Theme theme_;
+    std::vector<std::string> prev_;
+    std::string out_;
+    uint8_t color_{kUnknownColor};
+    bool drawn_{false};
+
+    // Copies each cell's pre-encoded bytes: a fixed-size copy from the
+    // prefix, or from the glyph when the colour is already set, then the
+    // cursor only advances by the real length.
+    void appendCells(const char *cells, size_t n)
+    {
+        size_t at = out_.size();
+        out_.resize(at + n * Theme::kCopy);
+        char *p = &out_[at];
+        for (size_t i = 0; i < n; i++)
+        {
+            const Theme::Entry &e = theme_[static_cast<uint8_t>(cells[i])];
+            size_t from = e.color == color_ ? e.glyph : 0;
+            std::memcpy(p, e.bytes.data() + from, Theme::kCopy);
+            p += e.len - from;
+            color_ = e.color;
+        }
+        out_.resize(static_cast<size_t>(p - out_.data()));
+    }
+
+    // Appends a cursor move to the 0-based (row, col) without temporaries.
+    void moveTo(size_t row, size_t col)
+    {
+        char seq[48] = "\x1b[";
+        char *p = std::to_chars(seq + 2, seq + 23, row + 1).ptr;
+        *p++ = ';';
+        p = std::to_chars(p, seq + 45, col + 1).ptr;
+        *p++ = 'H';
+        out_.append(seq, static_cast<size_t>(p - seq));
+    }
+};
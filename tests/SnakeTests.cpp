@@ -0,0 +1,472 @@
+// Checks run by ctest: the first argument names the test (see
+// CMakeLists.txt), and the exit code is non-zero if any of it failed.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Agents.h"
+#include "Engine.h"
+#include "Leaderboard.h"
+#include "Modes.h"
+#include "Replay.h"
+#include "Scene.h"
+
+namespace
+{
+int failures = 0;
+
+void check(bool ok, const std::string &what)
+{
+    if (!ok)
+    {
+        failures++;
+        std::cerr << "FAIL: " << what << "\n";
+    }
+}
+
+bool loadArena(Level &level)
+{
+    std::string error;
+    if (!Level::load("levels/arena.txt", level, error))
+    {
+        std::cerr << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Every cell of the field against the queue BFS, from random start cells.
+void compareDistances(const std::string &name, const Engine &e, int queries)
+{
+    DistanceField field;
+    std::vector<int> dist;
+    std::vector<Vec2> queue;
+    FastRng rng(5);
+    int bad = 0;
+    for (int i = 0; i < queries; i++)
+    {
+        Vec2 from{static_cast<int>(rng.next() % e.width()), static_cast<int>(rng.next() % e.height())};
+        if (!e.open(from))
+        {
+            continue;
+        }
+        field.compute(e, from);
+        bench::scalarDistances(e, from, dist, queue);
+        for (int y = 0; y < e.height(); y++)
+        {
+            for (int x = 0; x < e.width(); x++)
+            {
+                bad += field.at({x, y}) != dist[static_cast<size_t>(y) * e.width() + x];
+            }
+        }
+    }
+    check(bad == 0, name + ": " + std::to_string(bad) + " cells differ from BFS");
+}
+
+int distance()
+{
+    Level arena;
+    if (!loadArena(arena))
+    {
+        return 1;
+    }
+    for (bool wrap : {false, true})
+    {
+        Rules rules;
+        rules.wrap = wrap;
+        std::string suffix = wrap ? "/wrap" : "";
+        Engine onArena(arena, rules, 1);
+        compareDistances("arena" + suffix, onArena, 100);
+        Level empty = Level::empty(70, 30);
+        Engine onEmpty(empty, rules, 1);
+        compareDistances("empty" + suffix, onEmpty, 30);
+        Level walls = bench::obstacleBoard(30, 7);
+        Engine onWalls(walls, rules, 1);
+        compareDistances("obstacles" + suffix, onWalls, 10);
+    }
+
+    // A serpentine maze whose far end is more than 65535 steps away.
+    const int size = 403;
+    Level maze = Level::empty(size, size);
+    for (int y = 2; y < size - 2; y += 2)
+    {
+        for (int x = 1; x < size - 1; x++)
+        {
+            maze.cells[static_cast<size_t>(y) * size + x] = Level::kWall;
+        }
+        int gap = (y / 2) % 2 != 0 ? 1 : size - 2;
+        maze.cells[static_cast<size_t>(y) * size + gap] = Level::kEmpty;
+    }
+    maze.spawns = {{5, 1}};
+    Engine onMaze(maze, Rules{}, 1);
+    compareDistances("maze", onMaze, 2);
+    return failures == 0 ? 0 : 1;
+}
+
+// BitFlood's reached cells against a queue fill from the same cell, while a
+// random walk keeps changing where the body splits the board.
+void compareFloods(const std::string &name, const Level &level, const Rules &rules, int queries)
+{
+    Engine e(level, rules, 17);
+    BitFlood flood;
+    std::vector<uint8_t> seen;
+    std::vector<Vec2> queue;
+    FastRng rng(23);
+    int bad = 0;
+    uint32_t game = 0;
+    for (int i = 0; i < queries; i++)
+    {
+        for (int k = 0; k < 8; k++)
+        {
+            e.turn(static_cast<Dir>(rng.next() & 3));
+            for (int t = 0; t < 4 && !e.safe(e.dir()); t++)
+            {
+                e.turn(static_cast<Dir>(rng.next() & 3));
+            }
+            e.step();
+            if (e.gameOver())
+            {
+                e.reset(++game);
+            }
+        }
+        // The head half the time, so fills from occupied cells come up too.
+        Vec2 from = e.head();
+        if ((rng.next() & 1) != 0)
+        {
+            from.x = 1 + static_cast<int>(rng.next() % (level.w - 2));
+            from.y = 1 + static_cast<int>(rng.next() % (level.h - 2));
+        }
+        flood.area(e, from);
+        bench::scalarArea(e, from, seen, queue);
+        for (int y = 0; y < level.h; y++)
+        {
+            for (int x = 0; x < level.w; x++)
+            {
+                bad += flood.reached().test({x, y}) != (seen[static_cast<size_t>(y) * level.w + x] != 0);
+            }
+        }
+    }
+    check(bad == 0, name + ": " + std::to_string(bad) + " cells differ from a queue fill");
+}
+
+int flood()
+{
+    Level arena;
+    if (!loadArena(arena))
+    {
+        return 1;
+    }
+    // Two chambers whose only link is portal A, so the body standing on or
+    // next to an end decides what is reachable.
+    const char kChambers[] = "##############\n"
+                             "#     #      #\n"
+                             "#  A  #   A  #\n"
+                             "#  @  #      #\n"
+                             "#     #      #\n"
+                             "##############\n";
+    Level chambers;
+    std::string error;
+    if (!Level::parse(kChambers, sizeof(kChambers) - 1, chambers, error))
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    for (bool wrap : {false, true})
+    {
+        Rules rules;
+        rules.wrap = wrap;
+        std::string suffix = wrap ? "/wrap" : "";
+        compareFloods("arena" + suffix, arena, rules, 400);
+        compareFloods("empty" + suffix, Level::empty(70, 30), rules, 400);
+        compareFloods("chambers" + suffix, chambers, rules, 400);
+        for (uint64_t seed = 1; seed <= 3; seed++)
+        {
+            compareFloods("obstacles" + std::to_string(seed) + suffix, bench::obstacleBoard(35, seed), rules, 40);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Steps random games and compares the persistent, incrementally updated
+// frame against one built from scratch at every tick.
+void compareScenes(const std::string &name, const Level &level, const Rules &rules, int steps)
+{
+    Engine e(level, rules, 11);
+    Scene incremental(level);
+    FastRng rng(3);
+    int bad = 0;
+    uint32_t game = 0;
+    for (int i = 0; i < steps; i++)
+    {
+        if ((rng.next() & 3) == 0)
+        {
+            e.turn(static_cast<Dir>(rng.next() & 3));
+        }
+        for (int k = 0; k < 4 && !e.safe(e.dir()); k++)
+        {
+            e.turn(static_cast<Dir>(rng.next() & 3));
+        }
+        e.step();
+        double progress = i % 3 == 0 ? 0.0 : i % 3 == 1 ? 0.6 : 0.9;
+        if (i % 5 == 0)
+        {
+            incremental.build(e, 50, 0.7);
+        }
+        Scene full(level);
+        bad += incremental.build(e, 50, progress) != full.build(e, 50, progress);
+        if (e.gameOver())
+        {
+            incremental.build(e, 50);
+            e.reset(++game);
+        }
+    }
+    check(bad == 0, name + ": " + std::to_string(bad) + " frames differ from a full redraw");
+}
+
+int scene()
+{
+    Level arena;
+    if (!loadArena(arena))
+    {
+        return 1;
+    }
+    // Frequent power-ups so ghosting, shrinking and growth all come up.
+    Rules rules;
+    rules.powerUpChance = 100;
+    rules.effectTicks = 30;
+    rules.foodCount = 5;
+    for (bool wrap : {false, true})
+    {
+        rules.wrap = wrap;
+        std::string suffix = wrap ? "/wrap" : "";
+        compareScenes("empty" + suffix, Level::empty(30, 14), rules, 50000);
+        compareScenes("arena" + suffix, arena, rules, 20000);
+    }
+    // A crowded board, where only the items that changed are redrawn.
+    rules.wrap = false;
+    rules.foodCount = 150;
+    compareScenes("crowded", Level::empty(30, 14), rules, 20000);
+    return failures == 0 ? 0 : 1;
+}
+
+bool sameItems(const Engine &a, const Engine &b)
+{
+    const std::vector<Pickup> &x = a.items();
+    const std::vector<Pickup> &y = b.items();
+    return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin(), [](const Pickup &p, const Pickup &q) {
+               return p.pos == q.pos && p.item == q.item;
+           });
+}
+
+// Random games stepped in lockstep: one copy of each places its own food,
+// the other defers it to spawnFoodBatch(). On any tick only some games owe
+// food, and the batch goes through in groups of four, so odd game counts
+// leave partial groups.
+void compareSpawns(const std::string &name, const Level &level, const Rules &rules, uint64_t seed, size_t games)
+{
+    std::vector<Engine> single;
+    std::vector<Engine> batch;
+    std::vector<Engine *> ptrs;
+    single.reserve(games);
+    batch.reserve(games);
+    for (uint32_t g = 0; g < games; g++)
+    {
+        single.emplace_back(level, rules, seed, g);
+        batch.emplace_back(level, rules, seed, g);
+        ptrs.push_back(&batch.back());
+    }
+    FastRng rng(seed);
+    int bad = 0;
+    for (int tick = 0; tick < 400; tick++)
+    {
+        for (size_t g = 0; g < games; g++)
+        {
+            Dir d = static_cast<Dir>(rng.next() & 3);
+            for (int k = 0; k < 4 && !single[g].safe(d); k++)
+            {
+                d = static_cast<Dir>(rng.next() & 3);
+            }
+            single[g].turn(d);
+            batch[g].turn(d);
+            single[g].step();
+            batch[g].step(true);
+            if (single[g].gameOver())
+            {
+                single[g].reset(single[g].gameId() + static_cast<uint32_t>(games));
+                batch[g].reset(batch[g].gameId() + static_cast<uint32_t>(games));
+            }
+        }
+        Engine::spawnFoodBatch(ptrs.data(), ptrs.size());
+        for (size_t g = 0; g < games; g++)
+        {
+            bad += !sameItems(single[g], batch[g]) || single[g].score() != batch[g].score();
+        }
+    }
+    check(bad == 0, name + ": " + std::to_string(bad) + " game ticks differ between single and batched food");
+}
+
+int spawn()
+{
+    Level level = Level::empty(20, 12);
+    Rules sparse;
+    sparse.powerUpChance = 50;
+    sparse.foodCount = 3;
+    Rules crowded = sparse;
+    crowded.foodCount = 120;
+    for (uint64_t seed : {1ull, 42ull, 0xDEADBEEFCAFEull})
+    {
+        for (size_t games : {1, 2, 3, 4, 5, 7, 8, 13, 64})
+        {
+            std::string suffix = "/seed" + std::to_string(seed) + "/" + std::to_string(games) + " games";
+            compareSpawns("sparse" + suffix, level, sparse, seed, games);
+            compareSpawns("crowded" + suffix, level, crowded, seed, games);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+ScoreEntry entry(int score, uint64_t seed)
+{
+    ScoreEntry e;
+    e.score = score;
+    e.ticks = static_cast<uint32_t>(score * 3);
+    e.seed = seed;
+    e.time = 1700000000 + score;
+    std::memcpy(e.name.data(), "tester", 6);
+    return e;
+}
+
+bool same(const ScoreEntry &a, const ScoreEntry &b)
+{
+    return a.score == b.score && a.ticks == b.ticks && a.seed == b.seed && a.time == b.time && a.name == b.name;
+}
+
+int leaderboard()
+{
+    const std::string path = "snake-test.scores";
+    std::remove(path.c_str());
+    std::string error;
+    const int count = 300;
+    {
+        Leaderboard board;
+        check(board.open(path, error), "open: " + error);
+        FastRng rng(9);
+        for (int i = 0; i < count; i++)
+        {
+            check(board.add(entry(static_cast<int>(rng.next() % 1000), static_cast<uint64_t>(i))), "add");
+        }
+        check(board.flush(), "flush");
+    }
+
+    // Round trip: a new session reads back every record in score order.
+    Leaderboard board;
+    check(board.open(path, error), "reopen: " + error);
+    check(board.size() == count, "reopened size " + std::to_string(board.size()));
+    check(board.skipped() == 0, "clean log has skipped records");
+    std::vector<ScoreEntry> all = board.top(count);
+    FastRng rng(9);
+    std::vector<ScoreEntry> expected;
+    for (int i = 0; i < count; i++)
+    {
+        expected.push_back(entry(static_cast<int>(rng.next() % 1000), static_cast<uint64_t>(i)));
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const ScoreEntry &a, const ScoreEntry &b) { return a.score > b.score; });
+    bool match = all.size() == expected.size();
+    for (size_t i = 0; match && i < all.size(); i++)
+    {
+        match = same(all[i], expected[i]);
+    }
+    check(match, "records read back differ from those written");
+
+    // A torn record: the first 20 bytes of one, as a crash mid-write leaves
+    // them, then another session appends a whole record after it.
+    {
+        std::ifstream in(path, std::ios::binary);
+        char head[20];
+        in.read(head, sizeof(head));
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write(head, sizeof(head));
+    }
+    ScoreEntry after = entry(5000, 12345);
+    {
+        Leaderboard other;
+        check(other.open(path, error), "open torn log: " + error);
+        check(other.add(after) && other.flush(), "append after torn record");
+    }
+    check(board.reload(error), "reload: " + error);
+    check(board.skipped() == 1, "torn record skipped " + std::to_string(board.skipped()) + " times");
+    check(board.size() == count + 1, "size after resync " + std::to_string(board.size()));
+    std::vector<ScoreEntry> best = board.top(1);
+    check(best.size() == 1 && same(best[0], after), "record after the torn one lost");
+    board.close();
+    std::remove(path.c_str());
+    return failures == 0 ? 0 : 1;
+}
+
+// Replays whose board or rules the command line would refuse are rejected
+// before an engine is built from them.
+int replayLimits()
+{
+    const std::string path = "snake_tests.replay";
+    const char *bad[] = {
+        "board 0 0\nrules 0 1 1\n", "board 8 5\nrules 0 1 1\n", "board 4097 6\nrules 0 1 1\n",
+        "board 8 6\nrules 0 0 1\n", "board 8 6\nrules 0 1 -1\n",
+    };
+    for (const char *head : bad)
+    {
+        {
+            std::ofstream out(path, std::ios::trunc);
+            out << "snake-replay 1\n" << head << "seed 1 0\nresult 0 0\nturns 0\n";
+        }
+        Replay r;
+        std::string error;
+        check(!r.load(path, error) && !error.empty(), std::string("accepted replay with ") + head);
+    }
+    {
+        std::ofstream out(path, std::ios::trunc);
+        out << "snake-replay 1\nboard 8 6\nrules 0 1 0\nseed 1 0\nresult 0 0\nturns 0\n";
+    }
+    Replay r;
+    std::string error;
+    check(r.load(path, error), "smallest board rejected: " + error);
+    std::remove(path.c_str());
+    return failures == 0 ? 0 : 1;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string name = argc > 1 ? argv[1] : "";
+    if (name == "distance")
+    {
+        return distance();
+    }
+    if (name == "scene")
+    {
+        return scene();
+    }
+    if (name == "leaderboard")
+    {
+        return leaderboard();
+    }
+    if (name == "flood")
+    {
+        return flood();
+    }
+    if (name == "spawn")
+    {
+        return spawn();
+    }
+    if (name == "replay")
+    {
+        return replayLimits();
+    }
+    std::cerr << "usage: snake_tests distance|flood|scene|spawn|leaderboard|replay\n";
+    return 2;
+}